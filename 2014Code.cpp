@@ -3,20 +3,71 @@
 #include "WPILib.h"
 #include "NetworkTables/NetworkTable.h"
 #include "RobotMap.h"
+#include "RobotCore.h"
+#include "MotionProfile.h"
+#include "BufferedLCD.h"
+#include "VisionTarget.h"
+#include "RobotSnapshot.h"
+#include "LoopTimer.h"
+#include "HeadingController.h"
+#include "InputShaper.h"
+#include "TelemetryRecorder.h"
+#include "PressureEstimator.h"
+#include "CommandScheduler.h"
+#include "OutputStage.h"
+#include "RateExecutor.h"
+#include "PowerManager.h"
+#include "ShotProfiler.h"
+#include "StatusPublisher.h"
+#include "LauncherFaultManager.h"
+#include "AllocationGuard.h"
+
+#ifndef TELEMETRY_LOG
+#define TELEMETRY_LOG "/telemetry.bin"
+#endif
+#ifndef SHOT_REPORT
+#define SHOT_REPORT "/shots.txt"
+#endif
  
-class TM_2014_ROBOT : public IterativeRobot {
-    // Controllers
-    Joystick *controller;
-    Joystick *joystick;
+// The drive, controller and gyro; ports come from RobotMap.h
+struct TM_2014_Config {
+    static const DriveType kDriveType = MECANUM_DRIVE;
+    static const UINT32 kFrontLeftWheel = FRONT_LEFT_WHEEL;
+    static const UINT32 kRearLeftWheel = REAR_LEFT_WHEEL;
+    static const UINT32 kFrontRightWheel = FRONT_RIGHT_WHEEL;
+    static const UINT32 kRearRightWheel = REAR_RIGHT_WHEEL;
+    static const bool kInvertFrontLeft = false;
+    static const bool kInvertRearLeft = false;
+    static const bool kInvertFrontRight = true;
+    static const bool kInvertRearRight = true;
+    static const UINT32 kControllerPort = CONTROLLER;
+    static const bool kHasGyro = true;
+    static const UINT32 kGyroChannel = GYRO;
+    static const bool kHasEncoders = true;
+    static const UINT32 kFrontLeftEncoderA = FRONT_LEFT_ENCODER_A;
+    static const UINT32 kFrontLeftEncoderB = FRONT_LEFT_ENCODER_B;
+    static const UINT32 kRearLeftEncoderA = REAR_LEFT_ENCODER_A;
+    static const UINT32 kRearLeftEncoderB = REAR_LEFT_ENCODER_B;
+    static const UINT32 kFrontRightEncoderA = FRONT_RIGHT_ENCODER_A;
+    static const UINT32 kFrontRightEncoderB = FRONT_RIGHT_ENCODER_B;
+    static const UINT32 kRearRightEncoderA = REAR_RIGHT_ENCODER_A;
+    static const UINT32 kRearRightEncoderB = REAR_RIGHT_ENCODER_B;
+    static const UINT32 kEncoderPulses = 360;
+    static const UINT32 kWheelDiameterMm = 152;
+};
+ 
+// Camera light and vision target states, for toggleLED() and placeTargetStatus()
+enum eLEDState {LED_OFF, LED_ON};
+enum eTargetStatus {TARGET_NOT_DETECTED, TARGET_DETECTED, kNumTargetStatuses};
  
-    // Robot drive system
-    RobotDrive *tmRobotDrive;
+// Dashboard text, in eLauncherStatus and eTargetStatus order
+static const char *const kLauncherStatusText[] = {"Launcher Ready", "Launcher Pressurizing",
+    "Launcher Locked", "Launcher Dropped", "Launcher Raised", "Abnormal State"};
+static const char *const kTargetStatusText[] = {"No Target Detected", "Target Detected"};
  
-    // Talon motors
-    Talon *frontLeftWheel;
-    Talon *rearLeftWheel;
-    Talon *frontRightWheel;
-    Talon *rearRightWheel;
+class TM_2014_ROBOT : public RobotCore<TM_2014_Config> {
+    // Launcher joystick (the Xbox controller is in RobotCore)
+    Joystick *joystick;
      
     // Limit Switch
     DigitalInput* lockingLS;
@@ -26,23 +77,135 @@ class TM_2014_ROBOT : public IterativeRobot {
     DoubleSolenoid* solenoidLaunch;
     DoubleSolenoid* solenoidBlocker;
     DoubleSolenoid* solenoidLock;
+    // Decides when the launcher has pressure for a full-power shot
+    PressureEstimator pressure;
+    // Limits the drive and holds off the compressor so the battery doesn't
+    // brown out under load
+    PowerManager power;
      
     // Robot statuses
     enum eLauncherStatus {LAUNCHER_READY, LAUNCHER_PRESSURIZING, LAUNCHER_LOCKED, LAUNCHER_DOWN, LAUNCHER_RAISED, ABNORMAL_STATE};
     eLauncherStatus launcherStatus;
+    CORE_STATIC_ASSERT(sizeof(kLauncherStatusText) / sizeof(kLauncherStatusText[0]) == ABNORMAL_STATE + 1,
+                       launcher_status_text_matches);
+    // Checks the solenoids against the locking switch and runs the way back
+    // to locked and charging
+    LauncherFaultManager launcherFaults;
+    // Where shot-to-shot time goes; reported to SHOT_REPORT after each match
+    ShotProfiler shotProfiler;
+    
+    // A shot is under way: launchBall() released the launcher and
+    // updateLaunch() hasn't locked it again yet
+    bool launching;
+    bool launchFired;           // launchCommand has started its shot
      
     // Digital Outputs (spike relays)
     Relay* cameraLight;
      
-    // Gyro
-    Gyro* gyro;
+    // Every actuator write goes through here and reaches the hardware once
+    // per cycle, from applyOutputs(), except the heading controller's
+    // drive, which headingDrive writes from the controller's thread
+    OutputStage outputs;
+    OutputStage::DriveSource *headingDrive;     // the heading controller's way in
+    int launchOutput;
+    int lockOutput;
+    int blockerOutput;
+    int cameraLightOutput;
      
     // Timers
     Timer* timerLaunch;
     Timer* timerAuto;
      
-    DriverStationLCD *dsLCD;
     NetworkTable *coordinatesTable;
+    // What the dashboard is told about the target, sent when it changes;
+    // the strings are made once so sending doesn't build them
+    std::string targetStatusKey;
+    std::string targetStatusValues[kNumTargetStatuses];
+    int placedTargetStatus;
+    CORE_STATIC_ASSERT(sizeof(kTargetStatusText) / sizeof(kTargetStatusText[0]) == kNumTargetStatuses,
+                       target_status_text_matches);
+    TargetChannel *targetChannel;
+    GyroHistory gyroHistory;
+    DriverStation *ds;
+     
+    // Inputs for the current cycle, filled in by readInputs()
+    RobotSnapshot in;
+    // Deadband, expo, slew and inversion for each stick's axes
+    InputShaper controllerShaper;
+    InputShaper joystickShaper;
+    // The D-pad as two buttons, so it can be bound like the others
+    enum eDpadButton {DPAD_LEFT = 1, DPAD_RIGHT = 2};
+    UINT32 dpadButtons;
+     
+    // Work that runs at its own rate: drive and launcher in the periodic
+    // loop, dashboard and NetworkTables on background tasks
+    RateExecutor *executor;
+    float loopPeriod;
+    // What the background tasks get to see, published at the end of every
+    // cycle; the dashboard works from its own copy in shown
+    struct RobotStatus {
+        RobotSnapshot in;
+        const char *modeText;
+        eLauncherStatus launcherStatus;
+        float launcherPressure;
+        RobotPose pose;
+        bool poseKnown;
+        int autonomousState;
+        float driveX;
+        float driveY;
+        float driveRotation;
+    };
+    SnapshotMailbox<RobotStatus> statusMailbox;
+    RobotStatus shown;
+    // The status task's copy, sent to the dashboard as changed fields only
+    RobotStatus reported;
+    StatusPublisher statusPublisher;
+    // The networktables task's copy, for the target status
+    RobotStatus tabled;
+    const char *modeText;
+    // Vision targets, published by targetChannel as they arrive
+    SnapshotMailbox<TargetRecord> targetMailbox;
+    UINT32 targetSeen;
+     
+    // Subsystems and the commands that use them, one scheduler per rate.
+    // Buttons are bound in bindButtons(); autonomous schedules the same
+    // command objects.
+    typedef MemberCommand<TM_2014_ROBOT> TMCommand;
+    CommandScheduler driveScheduler;
+    CommandScheduler launcherScheduler;
+    RobotSubsystem *driveSubsystem;
+    RobotSubsystem *launcherSubsystem;
+    RobotSubsystem *lockSubsystem;
+    RobotSubsystem *blockerSubsystem;
+    RobotSubsystem *cameraLightSubsystem;
+    TMCommand *teleopDriveCommand;
+    TMCommand *followProfileCommand;
+    TMCommand *aimCommand;
+    TMCommand *launchCommand;
+    TMCommand *pressurizeCommand;
+    TMCommand *freeLauncherCommand;
+    TMCommand *extendLaunchCommand;
+    TMCommand *retractLaunchCommand;
+    TMCommand *recoverLauncherCommand;
+    TMCommand *extendLockCommand;
+    TMCommand *retractLockCommand;
+    TMCommand *blockerUpCommand;
+    TMCommand *blockerDownCommand;
+    TMCommand *lightOnCommand;
+    TMCommand *lightOffCommand;
+     
+    // Loop timing channels, added to loopTimer in this order
+    enum eTiming {TIME_ROBOT_INIT, TIME_DISABLED_INIT, TIME_AUTONOMOUS_INIT, TIME_TELEOP_INIT,
+                  TIME_DISABLED_PERIODIC, TIME_AUTONOMOUS_PERIODIC, TIME_TELEOP_PERIODIC,
+                  TIME_TELEOP_DRIVE, TIME_INDEX_LAUNCHER, TIME_OUTPUTS};
+    LoopTimer *loopTimer;
+     
+    // Every enabled cycle's inputs and outputs, written to TELEMETRY_LOG
+    TelemetryRecorder *telemetry;
+    TelemetryRecord cycleRecord;
+     
+    // Autonomous path, built in AutonomousInit
+    MotionProfile autoProfile;
      
     float speed;
     float strafe;
@@ -50,21 +213,18 @@ class TM_2014_ROBOT : public IterativeRobot {
      
     float armSpeed;
     float ballGatherSpeed;
-    float launchDelay;
+    float releaseTime;
+    float dropTime;
+    float autoAccel;
+    float autoDistance;
+    float autoSpeed;
  
     int autonomousState;
 public:
     // Initialize robot variables here
     TM_2014_ROBOT(void) {
-        // Initialize the  joystick
-        controller = new Joystick(CONTROLLER);
-        joystick   = new Joystick(JOYSTICK);
-         
-        // Initialize Talons
-        frontLeftWheel   = new Talon(FRONT_LEFT_WHEEL);
-        rearLeftWheel    = new Talon(REAR_LEFT_WHEEL);
-        frontRightWheel  = new Talon(FRONT_RIGHT_WHEEL);
-        rearRightWheel   = new Talon(REAR_RIGHT_WHEEL);
+        // Initialize the joystick
+        joystick = new Joystick(JOYSTICK);
          
         // Initialize Limit Switch
         lockingLS = new DigitalInput(LOCKING_MECHANISM_LS);
@@ -78,50 +238,212 @@ public:
         // Initialize Digital Outputs
         cameraLight = new Relay(CAMERA_LED);
          
-        // Initialize gyro
-        gyro = new Gyro(GYRO);
- 
         // Initialize timers
         timerLaunch = new Timer();
         timerAuto = new Timer();
          
-        dsLCD = DriverStationLCD::GetInstance();
         coordinatesTable = NetworkTable::GetTable("Target Status Table");
+        targetStatusKey = "Target Status";
+        for (int i = 0; i < kNumTargetStatuses; i++)
+            targetStatusValues[i] = kTargetStatusText[i];
+        placedTargetStatus = -1;
+        targetChannel = new TargetChannel(coordinatesTable, &targetMailbox);
+        ds = DriverStation::GetInstance();
+         
+        // Initialize loop timing
+        loopPeriod = 0.01;
+        SetPeriod(loopPeriod);
+        loopTimer = new LoopTimer("Loop Timing", loopPeriod);
+        loopTimer->addChannel("RobotInit");
+        loopTimer->addChannel("DisabledInit");
+        loopTimer->addChannel("AutonomousInit");
+        loopTimer->addChannel("TeleopInit");
+        loopTimer->addChannel("DisabledPeriodic", true);
+        loopTimer->addChannel("AutonomousPeriodic", true);
+        loopTimer->addChannel("TeleopPeriodic", true);
+        loopTimer->addChannel("teleopDrive");
+        loopTimer->addChannel("indexLauncherStatus");
+        loopTimer->addChannel("outputs");
+         
+        telemetry = new TelemetryRecorder(TELEMETRY_LOG);
+        memset(&cycleRecord, 0, sizeof(cycleRecord));
  
-        // Initialize robot drive system with the two wheels
-        tmRobotDrive = new RobotDrive(frontLeftWheel,rearLeftWheel,frontRightWheel,rearRightWheel);
+        launchOutput = outputs.addSolenoid(solenoidLaunch, "launch solenoid");
+        lockOutput = outputs.addSolenoid(solenoidLock, "lock solenoid");
+        blockerOutput = outputs.addSolenoid(solenoidBlocker, "blocker solenoid");
+        cameraLightOutput = outputs.addRelay(cameraLight, "camera light");
+        outputs.setDrive(driveMixer);
+        // the heading controller drives through the stage from its own thread
+        headingDrive = new OutputStage::DriveSource(&outputs, OutputStage::PRIORITY_COMMAND);
+        headingController->setOutput(headingDrive);
+        power.addDriveMotor(frontLeftWheel);
+        power.addDriveMotor(rearLeftWheel);
+        power.addDriveMotor(frontRightWheel);
+        power.addDriveMotor(rearRightWheel);
          
-        // Invert left wheel motors
-        tmRobotDrive->SetInvertedMotor(tmRobotDrive->kFrontRightMotor,true);
-        tmRobotDrive->SetInvertedMotor(tmRobotDrive->kRearRightMotor,true);
+        // Holds the heading in autonomous and while aiming, from its own
+        // 200 Hz thread
+        headingController->setFieldOriented(true);
+        loadAutonomousSettings();
          
         armSpeed = 0.8;
         ballGatherSpeed = 0.6;
-        launchDelay = 10.0;
+        releaseTime = 1.0;
+        dropTime = 2.0;
+        launching = false;
+        launchFired = false;
+        launcherStatus = ABNORMAL_STATE;
+        launcherFaults.setUnlockedTimeout(releaseTime + dropTime + 0.5);
+        // the locking switch hasn't been proven yet; set LockingSwitchTrusted
+        // once it has
+        launcherFaults.setCheckLockedRaised(Preferences::GetInstance()->GetBoolean("LockingSwitchTrusted", false));
+        autonomousState = 0;
+        // in eLauncherStatus order
+        shotProfiler.addState("ready", true);
+        shotProfiler.addState("pressurizing");
+        shotProfiler.addState("locked");
+        shotProfiler.addState("down");
+        shotProfiler.addState("raised");
+        shotProfiler.addState("abnormal");
+        // the timers and heading change every cycle; states go out at once
+        statusPublisher.setInterval(StatusCodec::GYRO_ANGLE, 0.1);
+        statusPublisher.setInterval(StatusCodec::LAUNCH_TIMER, 0.5);
+        statusPublisher.setInterval(StatusCodec::AUTONOMOUS_TIMER, 0.5);
+        statusPublisher.setInterval(StatusCodec::DRIVE_STRAFE, 0.1);
+        statusPublisher.setInterval(StatusCodec::DRIVE_SPEED, 0.1);
+        statusPublisher.setInterval(StatusCodec::DRIVE_ROTATION, 0.1);
+         
+        // Forward and strafe come out positive away from the driver
+        controllerShaper.configure(XBOX_LEFT_Y,   0.3, 0.3, 6.0, true);
+        controllerShaper.configure(XBOX_TRIGGERS, 0.1, 0.3, 6.0, true);
+        controllerShaper.configure(XBOX_RIGHT_X,  0.3, 0.3, 8.0);
+        dpadButtons = 0;
+        modeText = "Robot Enabled";
+        targetSeen = 0;
+         
+        createCommands();
+        bindButtons();
+        //bindTestButtons();
+         
+        // vxWorks priorities; the robot task itself runs at 101
+        executor = new RateExecutor();
+        addRateTask("drive", 0.01, 90, &TM_2014_ROBOT::runDrive);
+        addRateTask("launcher", 0.02, 95, &TM_2014_ROBOT::runLauncher);
+        addRateTask("dashboard", 0.1, 120, &TM_2014_ROBOT::updateDashboard);
+        addRateTask("networktables", 0.2, 130, &TM_2014_ROBOT::updateNetworkTables);
+        addRateTask("status", 0.05, 125, &TM_2014_ROBOT::sendStatus);
+    }
+    // Stops the background tasks, then lets the recorder write out whatever
+    // is still in its ring
+    ~TM_2014_ROBOT(void) {
+        delete executor;
+        delete telemetry;
     }
  
     /*************************** Miscellaneous Commands ***********************/   
+    // Reads every input once at the start of a cycle; everything else in the
+    // cycle works from this copy instead of going back to the hardware
+    void readInputs() {
+        in.time = Timer::GetFPGATimestamp();
+        for (int axis = 1; axis <= RobotSnapshot::kNumAxes; axis++) {
+            in.controllerAxes[axis] = controller->GetRawAxis(axis);
+            in.joystickAxes[axis] = joystick->GetRawAxis(axis);
+        }
+        controllerShaper.apply(in.controllerAxes, in.time);
+        joystickShaper.apply(in.joystickAxes, in.time);
+        in.controllerButtons = (UINT16) ds->GetStickButtons(TM_2014_Config::kControllerPort);
+        in.joystickButtons = (UINT16) ds->GetStickButtons(JOYSTICK);
+        dpadButtons = 0;
+        if (in.controllerAxes[XBOX_DPAD_X] < 0.0)
+            dpadButtons |= 1 << (DPAD_LEFT - 1);
+        if (in.controllerAxes[XBOX_DPAD_X] > 0.0)
+            dpadButtons |= 1 << (DPAD_RIGHT - 1);
+        in.launch = solenoidLaunch->Get();
+        in.lock = solenoidLock->Get();
+        in.blocker = solenoidBlocker->Get();
+        in.lockingLS = lockingLS->Get();
+        in.compressorEnabled = compressor->Enabled();
+        in.pressureSwitch = compressor->GetPressureSwitchValue() != 0;
+        in.batteryVoltage = ds->GetBatteryVoltage();
+        in.gyroAngle = gyro->getAngle();
+        in.timerLaunch = timerLaunch->Get();
+        in.timerAuto = timerAuto->Get();
+        in.newTarget = targetMailbox.readIfNew(in.target, targetSeen);
+        gyroHistory.record(in.time, in.gyroAngle);
+        pressure.update(in.time, in.compressorEnabled, in.pressureSwitch, in.launch, in.lock, in.blocker);
+        cycleRecord.setInputs(in);
+    }
+    // Hands this cycle's record to the telemetry recorder (never blocks)
+    void recordCycle(TelemetryRecord::Mode mode) {
+        cycleRecord.mode = mode;
+        cycleRecord.setSolenoidOutputs(in);
+        cycleRecord.launcherStatus = launcherStatus;
+        cycleRecord.autonomousState = autonomousState;
+        cycleRecord.launching = launching;
+        cycleRecord.tankPressure = pressure.tankPressure();
+        cycleRecord.launcherPressure = pressure.launcherPressure();
+        cycleRecord.driveLimit = power.driveLimit();
+        cycleRecord.compressorHeld = power.compressorHeld();
+        telemetry->record(cycleRecord);
+    }
+    // Sets this cycle's drive limit and starts or stops the compressor as
+    // the power manager says. The limit covers the heading controller too.
+    void managePower() {
+        power.update(in.time, in.batteryVoltage, in.compressorEnabled, in.pressureSwitch);
+        outputs.setDriveLimit(power.driveLimit());
+        bool held = power.compressorHeld();
+        if (held == in.compressorEnabled) {
+            if (held)
+                compressor->Stop();
+            else
+                compressor->Start();
+            in.compressorEnabled = !held;
+        }
+    }
+    // A new mode starts without a limit, with the compressor running
+    void resetPower() {
+        power.reset();
+        outputs.setDriveLimit(power.driveLimit());
+        compressor->Start();
+    }
     bool isActive(DigitalInput* limitSwitch) {
+        if (limitSwitch == lockingLS)
+            return in.lockingLS;
         return limitSwitch->Get();
     }
-    float thresholdValue(float value, float thresh = 0.2) {
-        //IS-3 is best tonk
-        if (value > 0.0) if (value < thresh) return 0.0;
-        else if (value < 0.0) if (value > -thresh) return 0.0;
-        return value;
+    void resetLaunchTimer() {
+        timerLaunch->Reset();
+        in.timerLaunch = 0.0;
+    }
+    // Slewed axes start again from zero in a new mode
+    void resetInputs() {
+        controllerShaper.reset();
+        joystickShaper.reset();
+    }
+    void toggleLED(eLEDState state) {
+        outputs.setRelay(cameraLightOutput, state == LED_ON ? Relay::kForward : Relay::kOff,
+                         OutputStage::PRIORITY_COMMAND);
     }
-    void toggleLED(string state) {
-        if (state == "on") cameraLight->Set(Relay::kForward);
-        else if (state == "off") cameraLight->Set(Relay::kOff);
+    // Sends this cycle's actuator commands to the hardware
+    void applyOutputs() {
+        ScopedTiming timing(loopTimer, TIME_OUTPUTS);
+        outputs.apply(Timer::GetFPGATimestamp());
+    }
+    void lightOn() {
+        toggleLED(LED_ON);
+    }
+    void lightOff() {
+        toggleLED(LED_OFF);
     }
     void indexLauncherStatus() {
-        // if loader down, locked, and fully pressurized
-//      if (isActive(lockingLS) && launcherLocked() && launcherPressurized() && timerLaunch->Get() > launchDelay)
-        if (launcherLocked() && launcherPressurized() && timerLaunch->Get() > launchDelay)
+        ScopedTiming timing(loopTimer, TIME_INDEX_LAUNCHER);
+        // if loader down, locked, and pressurized enough for a full shot
+//      if (isActive(lockingLS) && launcherLocked() && launcherPressurized() && pressure.ready())
+        if (launcherLocked() && launcherPressurized() && pressure.ready())
             launcherStatus = LAUNCHER_READY;
         // if loader down, locked, and pressurizing
-//      else if (isActive(lockingLS) && launcherLocked() && launcherPressurized() && timerLaunch->Get() < launchDelay)
-        else if (launcherLocked() && launcherPressurized() && timerLaunch->Get() < launchDelay)
+//      else if (isActive(lockingLS) && launcherLocked() && launcherPressurized() && !pressure.ready())
+        else if (launcherLocked() && launcherPressurized() && !pressure.ready())
             launcherStatus = LAUNCHER_PRESSURIZING;
         // if loader down, locked and not pressurizing
 //      else if (isActive(lockingLS) && launcherLocked() && launcherDown())
@@ -138,116 +460,356 @@ public:
         // if none of the above are true (e.g. launcher raised and locked)
         else
             launcherStatus = ABNORMAL_STATE;
+        shotProfiler.setState(launcherStatus);
+    }
+    // Hands this cycle's inputs and launcher state to the background tasks
+    void publishStatus() {
+        RobotStatus status;
+        status.in = in;
+        status.modeText = modeText;
+        status.launcherStatus = launcherStatus;
+        status.launcherPressure = pressure.launcherPressure();
+        status.poseKnown = poseEstimator->latest(status.pose);
+        status.autonomousState = autonomousState;
+        status.driveX = cycleRecord.driveX;
+        status.driveY = cycleRecord.driveY;
+        status.driveRotation = cycleRecord.driveRotation;
+        statusMailbox.publish(status);
+    }
+    /****************************** Rate Tasks *********************************/
+    // A task the executor has no room for would never run, so it is
+    // reported; the executor takes kMaxTasks tasks at kMaxGroups priorities
+    // (the robot task's own and better counting as one)
+    void addRateTask(const char *name, double period, INT32 priority, void (TM_2014_ROBOT::*method)()) {
+        if (!executor->addTask(name, period, priority, this, method))
+            printf("rate executor: no room for the %s task at priority %d (%d tasks, %d priorities at most)\n",
+                   name, (int) priority, RateExecutor::kMaxTasks, RateExecutor::kMaxGroups);
     }
-    void printMessage(char* message, char lineNum) {
-        dsLCD->PrintfLine((DriverStationLCD::Line) lineNum, message);
-        dsLCD->UpdateLCD();
+    // drive (100 Hz, periodic loop)
+    void runDrive() {
+        driveScheduler.run();
+        recordHeadingDrive();
+    }
+    // launcher (50 Hz, periodic loop): launcher state, buttons and the launch
+    void runLauncher() {
+        indexLauncherStatus();
+        checkLauncher();
+        shotProfiler.setTrigger(getJoystickButton(1));
+        launcherScheduler.run();
+    }
+    // dashboard (10 Hz, background): the LCD, only from the published status
+    void updateDashboard() {
+        if (!statusMailbox.read(shown))
+            return;
+        lcd->clear();
+        printMessage(shown.modeText, 0);
+        displayStatusOnDashboard();
+        printTargetStatus(3);
+        if (shown.poseKnown) {
+            lcd->setNumber(4, "Field x", shown.pose.x);
+            lcd->setNumber(5, "Field y", shown.pose.y);
+        }
+        lcd->flush();
+    }
+    // networktables (5 Hz, background): loop timing and the target status
+    // out, from the task's own copy of the published status
+    void updateNetworkTables() {
+        loopTimer->publish();
+        if (statusMailbox.read(tabled))
+            placeTargetStatus(tabled.in.target.detected ? TARGET_DETECTED : TARGET_NOT_DETECTED);
+    }
+    // status (20 Hz, background): the published status to the dashboard,
+    // one frame of whatever differs from the last keyframe
+    void sendStatus() {
+        if (!statusMailbox.read(reported))
+            return;
+        float heading = fmod(reported.in.gyroAngle, 360.0f);
+        if (heading > 180.0f)
+            heading -= 360.0f;
+        else if (heading < -180.0f)
+            heading += 360.0f;
+        int solenoids = reported.in.launch | reported.in.lock << 2 | reported.in.blocker << 4;
+        statusPublisher.set(StatusCodec::LAUNCHER_STATUS, reported.launcherStatus);
+        statusPublisher.set(StatusCodec::AUTONOMOUS_STATE, reported.autonomousState);
+        statusPublisher.set(StatusCodec::SOLENOIDS, solenoids);
+        statusPublisher.set(StatusCodec::GYRO_ANGLE, heading);
+        statusPublisher.set(StatusCodec::LAUNCH_TIMER, reported.in.timerLaunch);
+        statusPublisher.set(StatusCodec::AUTONOMOUS_TIMER, reported.in.timerAuto);
+        statusPublisher.set(StatusCodec::DRIVE_STRAFE, reported.driveX);
+        statusPublisher.set(StatusCodec::DRIVE_SPEED, reported.driveY);
+        statusPublisher.set(StatusCodec::DRIVE_ROTATION, reported.driveRotation);
+        statusPublisher.flush(Timer::GetFPGATimestamp());
     }
     void displayStatusOnDashboard(char lineNum = 1) {
-        if (launcherStatus == LAUNCHER_READY)
-            printMessage("Launcher Ready", lineNum);
-        else if (launcherStatus == LAUNCHER_PRESSURIZING)
-            printMessage("Launcher Pressurizing", lineNum);
-        else if (launcherStatus == LAUNCHER_LOCKED)
-            printMessage("Launcher Locked", lineNum);
-        else if (launcherStatus == LAUNCHER_DOWN)
-            printMessage("Launcher Dropped", lineNum);
-        else if (launcherStatus == LAUNCHER_RAISED)
-            printMessage("Launcher Raised", lineNum);
-        else if (launcherStatus == ABNORMAL_STATE)
-            printMessage("Abnormal State", lineNum);
+        printMessage(kLauncherStatusText[shown.launcherStatus], lineNum);
+        lcd->setNumber(lineNum + 1, "Launcher psi", shown.launcherPressure, 0);
     }
     bool getXboxButton(int btnNum) {
-        return controller->GetRawButton(btnNum);
+        return in.controllerButton(btnNum);
     }
     bool getJoystickButton(int btnNum) {
-        return joystick->GetRawButton(btnNum);
+        return in.joystickButton(btnNum);
     }
     float getXboxAxis(int axisNum) {
-        return controller->GetRawAxis(axisNum);
+        return in.controllerAxes[axisNum];
     }
     float getJoystickAxis(int axisNum) {
-        return joystick->GetRawAxis(axisNum);
+        return in.joystickAxes[axisNum];
     }
     /******************************* Drive Commands ****************************/
-    void mecDrive(float x, float y, float rotation, float gyroAngle = 0.0) {
-        tmRobotDrive->MecanumDrive_Cartesian(x, y, rotation, gyroAngle);
+    void mecDrive(float x, float y, float rotation, float gyroAngle = 0.0,
+                  OutputStage::Priority priority = OutputStage::PRIORITY_DEFAULT) {
+        if (!outputs.drive(x, y, rotation, gyroAngle, priority))
+            return;
+        cycleRecord.driveX = x;
+        cycleRecord.driveY = y;
+        cycleRecord.driveRotation = rotation;
     }
+    // Wins over any other drive command in the same cycle
     void stopRobot() {
-        mecDrive(0.0,0.0,0.0);
+        mecDrive(0.0,0.0,0.0,0.0,OutputStage::PRIORITY_SAFETY);
+    }
+    // Hands the autonomous profile sample for this point in time to the
+    // heading controller, which holds the profile heading while driving it
+    void followProfile(float time) {
+        const ProfileSample& sample = autoProfile.sampleAt(time);
+        headingController->setDrive(sample.x, sample.y);
+        headingController->holdHeading(sample.heading, sample.rotation);
+    }
+    // The autonomous path and heading gains, from the preferences file so
+    // they can be tuned without a rebuild; read again in every AutonomousInit
+    void loadAutonomousSettings() {
+        Preferences *prefs = Preferences::GetInstance();
+        autoDistance = prefs->GetFloat("AutoDistance", 1.2);
+        autoSpeed = prefs->GetFloat("AutoSpeed", 1.0);
+        autoAccel = prefs->GetFloat("AutoAccel", 4.0);
+        headingController->setGains(prefs->GetFloat("HeadingP", 0.02), prefs->GetFloat("HeadingI", 0.01),
+                                    prefs->GetFloat("HeadingD", 0.001));
+    }
+    // While the heading controller is enabled it drives from its own
+    // thread; the cycle's telemetry and status get its last command
+    void recordHeadingDrive() {
+        float x, y, rotation, angle;
+        if (!headingController->getOutput(x, y, rotation, angle))
+            return;
+        cycleRecord.driveX = x;
+        cycleRecord.driveY = y;
+        cycleRecord.driveRotation = rotation;
     }
     void teleopDrive() {
-        speed = -thresholdValue(getXboxAxis(LEFT_ANALOG_Y),0.3);
-        strafe = -getXboxAxis(TRIGGERS);
-        rotation = thresholdValue(controller->GetRawAxis(RIGHT_ANALOG_X),0.3);
+        ScopedTiming timing(loopTimer, TIME_TELEOP_DRIVE);
+        // already deadbanded, curved and slew limited by controllerShaper
+        speed = getXboxAxis(XBOX_LEFT_Y);
+        strafe = getXboxAxis(XBOX_TRIGGERS);
+        rotation = getXboxAxis(XBOX_RIGHT_X);
         mecDrive(strafe,speed,rotation);
     }
-    void teleopShooter() {
-        if (joystick->GetTrigger())
-            launchBall();
-        if (getJoystickButton(3))
-            moveBlockerUp();
-        if (getJoystickButton(2))
-            moveBlockerDown();
-        if (getJoystickButton(10))
-            freeSolenoids();
-        if (getJoystickButton(11))
-            pressurizeLauncher();
-        if (getJoystickButton(6))
-            extend(solenoidLock);
-        if (getJoystickButton(7))
-            retract(solenoidLock);
+    // aimCommand: the heading controller turns to the newest target, from
+    // the heading the robot had when its frame was taken. Without one it
+    // holds the heading it started on.
+    void startAim() {
+        float heading;
+        if (!getTargetHeading(heading))
+            heading = in.gyroAngle;
+        headingController->enable();
+        headingController->turnTo(heading);
+    }
+    void runAim() {
+        float heading;
+        if (in.newTarget && getTargetHeading(heading))
+            headingController->turnTo(heading);
+    }
+    // teleopDrive takes over again
+    void endAim() {
+        headingController->disable();
+    }
+    void runAutoProfile() {
+        followProfile(in.timerAuto);
+    }
+    // past the end of the profile the controller stops and holds the heading
+    bool autoProfileDone() {
+        return autoProfile.done(in.timerAuto);
+    }
+    /******************************* Commands **********************************/
+    void createCommands() {
+        driveSubsystem       = new RobotSubsystem("drive");
+        launcherSubsystem    = new RobotSubsystem("launcher");
+        lockSubsystem        = new RobotSubsystem("lock");
+        blockerSubsystem     = new RobotSubsystem("blocker");
+        cameraLightSubsystem = new RobotSubsystem("camera light");
+         
+        teleopDriveCommand = new TMCommand("teleop drive", this, 0, &TM_2014_ROBOT::teleopDrive);
+        teleopDriveCommand->requires(driveSubsystem);
+        followProfileCommand = new TMCommand("follow profile", this, 0, &TM_2014_ROBOT::runAutoProfile,
+                                             &TM_2014_ROBOT::autoProfileDone);
+        followProfileCommand->requires(driveSubsystem);
+        // held: turns in place to the target
+        aimCommand = new TMCommand("aim", this, &TM_2014_ROBOT::startAim, &TM_2014_ROBOT::runAim);
+        aimCommand->setEnd(&TM_2014_ROBOT::endAim);
+        aimCommand->requires(driveSubsystem);
+         
+        // the launch sequence owns all of the solenoids until it finishes
+        launchCommand = new TMCommand("launch", this, &TM_2014_ROBOT::startLaunch,
+                                      &TM_2014_ROBOT::runLaunch, &TM_2014_ROBOT::launchDone);
+        launchCommand->setInterruptible(&TM_2014_ROBOT::launchWaiting);
+        launchCommand->requires(launcherSubsystem);
+        launchCommand->requires(lockSubsystem);
+        launchCommand->requires(blockerSubsystem);
+        pressurizeCommand = new TMCommand("pressurize", this, &TM_2014_ROBOT::pressurizeLauncher);
+        pressurizeCommand->requires(launcherSubsystem);
+        freeLauncherCommand = new TMCommand("free launcher", this, &TM_2014_ROBOT::freeSolenoids);
+        freeLauncherCommand->requires(launcherSubsystem);
+        extendLaunchCommand = new TMCommand("extend launch", this, &TM_2014_ROBOT::extendLaunch);
+        extendLaunchCommand->requires(launcherSubsystem);
+        retractLaunchCommand = new TMCommand("retract launch", this, &TM_2014_ROBOT::retractLaunch);
+        retractLaunchCommand->requires(launcherSubsystem);
+        // runs to the end once started; a mode change still stops it
+        recoverLauncherCommand = new TMCommand("recover launcher", this, &TM_2014_ROBOT::startRecovery,
+                                               &TM_2014_ROBOT::runRecovery, &TM_2014_ROBOT::recoveryDone);
+        recoverLauncherCommand->setInterruptible(&TM_2014_ROBOT::recoveryInterruptible);
+        recoverLauncherCommand->setEnd(&TM_2014_ROBOT::endRecovery);
+        recoverLauncherCommand->requires(launcherSubsystem);
+        recoverLauncherCommand->requires(lockSubsystem);
+         
+        // hold the lock until another command takes it, so the fault
+        // manager leaves a lock put in by hand alone
+        extendLockCommand = new TMCommand("extend lock", this, &TM_2014_ROBOT::extendLock,
+                                          &TM_2014_ROBOT::holdLock);
+        extendLockCommand->requires(lockSubsystem);
+        retractLockCommand = new TMCommand("retract lock", this, &TM_2014_ROBOT::retractLock,
+                                           &TM_2014_ROBOT::holdLock);
+        retractLockCommand->requires(lockSubsystem);
+         
+        blockerUpCommand = new TMCommand("blocker up", this, &TM_2014_ROBOT::moveBlockerUp);
+        blockerUpCommand->requires(blockerSubsystem);
+        blockerDownCommand = new TMCommand("blocker down", this, &TM_2014_ROBOT::moveBlockerDown);
+        blockerDownCommand->requires(blockerSubsystem);
+         
+        lightOnCommand = new TMCommand("light on", this, &TM_2014_ROBOT::lightOn);
+        lightOnCommand->requires(cameraLightSubsystem);
+        lightOffCommand = new TMCommand("light off", this, &TM_2014_ROBOT::lightOff);
+        lightOffCommand->requires(cameraLightSubsystem);
+    }
+    // Teleop buttons; the drive runs as the drive subsystem's default command
+    void bindButtons() {
+        // clicking the turning stick in aims
+        driveScheduler.bind(&in.controllerButtons, XBOX_RIGHT_ANALOG_PRESS, CommandScheduler::WHILE_HELD,
+                            aimCommand);
+        // held trigger: fires as soon as the launcher is ready, letting go
+        // before then calls the shot off
+        launcherScheduler.bind(&in.joystickButtons, 1, CommandScheduler::WHILE_HELD, launchCommand);
+        launcherScheduler.bind(&in.joystickButtons, 3, CommandScheduler::WHEN_PRESSED, blockerUpCommand);
+        launcherScheduler.bind(&in.joystickButtons, 2, CommandScheduler::WHEN_PRESSED, blockerDownCommand);
+        launcherScheduler.bind(&in.joystickButtons, 10, CommandScheduler::WHEN_PRESSED, freeLauncherCommand);
+        launcherScheduler.bind(&in.joystickButtons, 11, CommandScheduler::WHEN_PRESSED, pressurizeCommand);
+        launcherScheduler.bind(&in.joystickButtons, 6, CommandScheduler::WHEN_PRESSED, extendLockCommand);
+        launcherScheduler.bind(&in.joystickButtons, 7, CommandScheduler::WHEN_PRESSED, retractLockCommand);
     }
     /******************************* Pneumatics Commands ***********************/
-    void retract(DoubleSolenoid* solenoid) {
-        solenoid->Set(DoubleSolenoid::kReverse);
+    // The snapshot copy of a solenoid; writes update it so the rest of the
+    // cycle sees what was commanded
+    DoubleSolenoid::Value& snapshotOf(DoubleSolenoid* solenoid) {
+        if (solenoid == solenoidLaunch)
+            return in.launch;
+        if (solenoid == solenoidLock)
+            return in.lock;
+        return in.blocker;
     }
-    void extend(DoubleSolenoid* solenoid) {
-        solenoid->Set(DoubleSolenoid::kForward);
+    int outputOf(DoubleSolenoid* solenoid) {
+        if (solenoid == solenoidLaunch)
+            return launchOutput;
+        if (solenoid == solenoidLock)
+            return lockOutput;
+        return blockerOutput;
+    }
+    // The snapshot gets whichever command wins this cycle, not necessarily
+    // this one
+    void retract(DoubleSolenoid* solenoid,
+                 OutputStage::Priority priority = OutputStage::PRIORITY_COMMAND) {
+        snapshotOf(solenoid) = outputs.setSolenoid(outputOf(solenoid), DoubleSolenoid::kReverse, priority);
+    }
+    void extend(DoubleSolenoid* solenoid,
+                OutputStage::Priority priority = OutputStage::PRIORITY_COMMAND) {
+        snapshotOf(solenoid) = outputs.setSolenoid(outputOf(solenoid), DoubleSolenoid::kForward, priority);
+    }
+    // For a sequence step; kOff leaves the solenoid as it is
+    void holdSolenoid(DoubleSolenoid* solenoid, DoubleSolenoid::Value value) {
+        if (value != DoubleSolenoid::kOff)
+            snapshotOf(solenoid) = outputs.setSolenoid(outputOf(solenoid), value, OutputStage::PRIORITY_SEQUENCE);
     }
     bool isRetracted(DoubleSolenoid* solenoid) {
-        return solenoid->Get() == DoubleSolenoid::kReverse;
+        return snapshotOf(solenoid) == DoubleSolenoid::kReverse;
     }
     bool isExtended(DoubleSolenoid* solenoid) {
-        return solenoid->Get() == DoubleSolenoid::kForward;
+        return snapshotOf(solenoid) == DoubleSolenoid::kForward;
     }
     void pressurizeLauncher() {
         indexLauncherStatus();
         if (launcherStatus == LAUNCHER_LOCKED)
             retract(solenoidLaunch);
-        displayStatusOnDashboard();
     }
     void dropLauncher() {
         indexLauncherStatus();
         if (launcherStatus == LAUNCHER_RAISED)
             extend(solenoidLaunch);
-        displayStatusOnDashboard();
     }
     void lockLauncher() {
         indexLauncherStatus();
         if (launcherStatus == LAUNCHER_DOWN)
             extend(solenoidLock);
-        displayStatusOnDashboard();
     }
     void releaseLauncher() {
         indexLauncherStatus();
         if (launcherStatus == LAUNCHER_READY)
             retract(solenoidLock);
-        displayStatusOnDashboard(); 
     }
-    void initializeSolenoids(bool autonomous = true) {
-        if (autonomous) {
-            extend(solenoidLaunch);
-            Wait(0.5);
-        }
-        extend(solenoidLock);
-        Wait(1.0);
+    void extendLaunch() {
+        extend(solenoidLaunch);
+    }
+    void retractLaunch() {
         retract(solenoidLaunch);
-        displayStatusOnDashboard();
+    }
+    void extendLock() {
+        extend(solenoidLock);
+    }
+    void retractLock() {
+        retract(solenoidLock);
+    }
+    void holdLock() {
+    }
+    bool lockByHand() {
+        RobotCommand *holder = lockSubsystem->getCurrentCommand();
+        return holder == extendLockCommand || holder == retractLockCommand;
+    }
+    // Starts the way back to locked and charging when the launcher is in a
+    // state it can't shoot from; replaces the blocking initializeSolenoids()
+    void checkLauncher() {
+        launcherFaults.update(in.time, in.launch, in.lock, isActive(lockingLS), lockByHand());
+        if (launcherFaults.needsRecovery(in.time))
+            launcherScheduler.schedule(recoverLauncherCommand);
+    }
+    // recoverLauncherCommand: one step of the fault manager's sequence a
+    // cycle. Started without a fault (the reset button) it drops, locks and
+    // charges.
+    void startRecovery() {
+        launcherFaults.start(in.time);
+    }
+    void runRecovery() {
+        launcherFaults.run(in.time, isActive(lockingLS));
+        holdSolenoid(solenoidLaunch, launcherFaults.launchOutput());
+        holdSolenoid(solenoidLock, launcherFaults.lockOutput());
+    }
+    bool recoveryDone() {
+        return !launcherFaults.isRecovering();
+    }
+    bool recoveryInterruptible() {
+        return false;
+    }
+    void endRecovery() {
+        launcherFaults.stop();
     }
     void freeSolenoids() {
         extend(solenoidLaunch);
-        displayStatusOnDashboard();
     }
     bool launcherPressurized() {
         return isRetracted(solenoidLaunch);
@@ -265,23 +827,47 @@ public:
     void launchBall(bool indexStatus = true) {
         if (indexStatus)
             indexLauncherStatus();
-        displayStatusOnDashboard();
-        if (launcherStatus == LAUNCHER_READY) {
+        if (!launching && launcherStatus == LAUNCHER_READY) {
             releaseLauncher();
-            Wait(1.0);
-            displayStatusOnDashboard();
+            resetLaunchTimer();
+            launching = true;
+            shotProfiler.shotFired();
+        }
+    }
+    // launchCommand: waits for the launcher to be ready, then runs the launch
+    // sequence; it can only be called off while it is still waiting
+    void startLaunch() {
+        launchFired = false;
+    }
+    void runLaunch() {
+        if (!launchFired) {
+            launchBall();
+            launchFired = launching;
+        }
+        updateLaunch();
+    }
+    bool launchDone() {
+        return launchFired && !launching;
+    }
+    bool launchWaiting() {
+        return !launching;
+    }
+    // Steps the shot started by launchBall() from the launcher status and
+    // timerLaunch instead of Wait(), so the periodic loop keeps driving while
+    // it happens: raised for releaseTime, then dropped, then after dropTime
+    // locked and charging again
+    void updateLaunch() {
+        if (!launching)
+            return;
+        indexLauncherStatus();
+        if (launcherStatus == LAUNCHER_RAISED && in.timerLaunch > releaseTime)
             dropLauncher();
-//          while (launcherStatus != LAUNCHER_DOWN) {
-//              indexLauncherStatus();
-//              displayStatusOnDashboard();
-//          }
-            Wait(2.0);
-            launcherStatus = LAUNCHER_DOWN;
-            displayStatusOnDashboard();
+        else if (in.timerLaunch > releaseTime + dropTime) {
+            // locks from down; anything else is left to the fault manager
             lockLauncher();
             pressurizeLauncher();
-            displayStatusOnDashboard();
-            timerLaunch->Reset();
+            resetLaunchTimer();
+            launching = false;
         }
     }
     void moveBlockerUp() {
@@ -292,148 +878,203 @@ public:
     }
     /********************************* Test Commands ***************************/
     void testLimitSwitch(char lineNum = 1) {
-        if (lockingLS->Get() == false)
+        if (in.lockingLS == false)
             printMessage("Locking false", lineNum);
-        else if (lockingLS->Get() == true)
+        else if (in.lockingLS == true)
             printMessage("Locking true", lineNum);  
     }
-    void lightControl() {
-        if (controller->GetRawAxis(DPAD_X) < 0.0)
-            toggleLED("off");
-        if (controller->GetRawAxis(DPAD_X) > 0.0)
-            toggleLED("on");
-    }   
- 
-    void testSolenoids(char lineNum = 2) {
-        if (getXboxButton(A)) {
-            extend(solenoidLaunch);
-            printMessage("Launch extended", lineNum);
-        }
-        else if (getXboxButton(Y)) {
-            retract(solenoidLaunch);
-            printMessage("Launch retracted", lineNum);
-        }
-        else if (getXboxButton(RIGHT_BUMPER)) {
-            retract(solenoidLock);
-            printMessage("Lock retracted", lineNum);
-        }
-        else if (getXboxButton(LEFT_BUMPER)) {
-            extend(solenoidLock);
-            printMessage("Lock extended", lineNum);
-        }
-        else if (getXboxButton(X)) {
-            retract(solenoidBlocker);
-            printMessage("Blocker retracted", lineNum);
-        }
-        else if (getXboxButton(B)) {
-            extend(solenoidBlocker);
-            printMessage("Blocker extended", lineNum);
-        }
-        else if (getXboxButton(LEFT_ANALOG_PRESS)) {
-            initializeSolenoids();
-            printMessage("Solenoids reset", lineNum);
-        }
-        indexLauncherStatus();
-        displayStatusOnDashboard();
+    // D-pad camera light and Xbox buttons for each solenoid
+    void bindTestButtons() {
+        launcherScheduler.bind(&dpadButtons, DPAD_LEFT, CommandScheduler::WHEN_PRESSED, lightOffCommand);
+        launcherScheduler.bind(&dpadButtons, DPAD_RIGHT, CommandScheduler::WHEN_PRESSED, lightOnCommand);
+        launcherScheduler.bind(&in.controllerButtons, XBOX_A, CommandScheduler::WHEN_PRESSED, extendLaunchCommand);
+        launcherScheduler.bind(&in.controllerButtons, XBOX_Y, CommandScheduler::WHEN_PRESSED, retractLaunchCommand);
+        launcherScheduler.bind(&in.controllerButtons, XBOX_RIGHT_BUMPER, CommandScheduler::WHEN_PRESSED, retractLockCommand);
+        launcherScheduler.bind(&in.controllerButtons, XBOX_LEFT_BUMPER, CommandScheduler::WHEN_PRESSED, extendLockCommand);
+        launcherScheduler.bind(&in.controllerButtons, XBOX_X, CommandScheduler::WHEN_PRESSED, blockerUpCommand);
+        launcherScheduler.bind(&in.controllerButtons, XBOX_B, CommandScheduler::WHEN_PRESSED, blockerDownCommand);
+        launcherScheduler.bind(&in.controllerButtons, XBOX_LEFT_ANALOG_PRESS, CommandScheduler::WHEN_PRESSED,
+                       recoverLauncherCommand);
     }
     /****************************** Networking Commands *************************/
-    void placeTargetStatus(string targetStatus) {
-        coordinatesTable->PutString("Target Status", targetStatus);
+    void placeTargetStatus(eTargetStatus status) {
+        if (status == placedTargetStatus)
+            return;
+        coordinatesTable->PutString(targetStatusKey, targetStatusValues[status]);
+        placedTargetStatus = status;
     }
-    string getTargetStatus() {
-        return coordinatesTable->GetString("Target Status");
+    eTargetStatus targetStatus() {
+        return in.target.detected ? TARGET_DETECTED : TARGET_NOT_DETECTED;
     }
     bool targetDetected() {
-        return getTargetStatus() == "Target Detected";
+        return targetStatus() == TARGET_DETECTED;
+    }
+    // Gyro heading that points at the target, worked out from the heading
+    // the robot had when the camera frame was taken
+    bool getTargetHeading(float& heading) {
+        float angleAtCapture;
+        if (!in.target.detected || !gyroHistory.angleAt(in.target.captureTime, angleAtCapture))
+            return false;
+        heading = angleAtCapture + in.target.xOffset;
+        return true;
     }
     void printTargetStatus(char lineNum = 2) {
-        if (targetDetected())
-            printMessage("Target Detected", lineNum);
-        else
-            printMessage("No Target Detected", lineNum);
+        printMessage(kTargetStatusText[shown.in.target.detected ? TARGET_DETECTED : TARGET_NOT_DETECTED], lineNum);
     }
     /********************************** Init Routines *****************************************/
     void RobotInit(void) {
-        dsLCD->Clear();
-        printMessage("Robot Enabled", 0);
-        gyro->Reset();
+        ScopedTiming timing(loopTimer, TIME_ROBOT_INIT);
+        zeroHeading();
         compressor->Start();
+        executor->start();
+        publishStatus();
+        AllocationGuard::arm(ALLOCATION_GUARD);
     }
     void DisabledInit(void) {
-        dsLCD->Clear();
-        printMessage("Robot Disabled", 0);
-        gyro->Reset();
+        ScopedTiming timing(loopTimer, TIME_DISABLED_INIT);
+        modeText = "Robot Disabled";
+        headingController->disable();
+        shotProfiler.pause();
+        // end of a match (or of autonomous): print how the loops did
+        if (!loopTimer->empty()) {
+            loopTimer->dump();
+            executor->dump();
+            outputs.dump();
+            power.dump();
+            AllocationGuard::dump();
+            launcherFaults.dump();
+            statusPublisher.dump();
+            lcd->dump();
+            gyro->dump();
+        }
+        if (!shotProfiler.empty()) {
+            shotProfiler.dump();
+            shotProfiler.publish();
+            shotProfiler.writeReport(SHOT_REPORT);
+        }
+        loopTimer->modeChanged();
+        driveScheduler.cancelAll();
+        launcherScheduler.cancelAll();
+        outputs.invalidate();
+        stopRobot();
+        applyOutputs();
+        launcherScheduler.setButtonsEnabled(false);
+        driveScheduler.setButtonsEnabled(false);
+        launching = false;
+        resetPower();
+        publishStatus();
     }
     void AutonomousInit(void) {
-        dsLCD->Clear();
-        printMessage("Autonomous Mode", 0);
-        gyro->Reset();
+        ScopedTiming timing(loopTimer, TIME_AUTONOMOUS_INIT);
+        modeText = "Autonomous Mode";
+        zeroHeading();
+        loopTimer->reset();
+        power.clearStats();
+        statusPublisher.clearStats();
+        launcherFaults.clearStats();
+        AllocationGuard::clearStats();
+        shotProfiler.clear();
+        headingController->enable();
+        gyroHistory.clear();
         timerLaunch->Start();
         timerLaunch->Reset();
         timerAuto->Start();
         timerAuto->Reset();
         autonomousState = 0;
-        moveBlockerDown();
-        initializeSolenoids();
+        driveScheduler.cancelAll();
+        launcherScheduler.cancelAll();
+        outputs.invalidate();
+        launching = false;
+        resetPower();
+        resetInputs();
+        readInputs();
+        launcherScheduler.setButtonsEnabled(false);
+        driveScheduler.setButtonsEnabled(false);
+        loadAutonomousSettings();
+        autoProfile.clear();
+        if (!autoProfile.addSegment(0.0, autoDistance, 0.0, autoSpeed, autoAccel))
+            printf("autonomous path is longer than %d samples; it stops short\n", MotionProfile::kMaxSamples);
+        //autoProfile.addSegment(0.0, -0.7, 0.0, 1.0, autoAccel);
+        //autoProfile.addSegment(0.0, 0.7, 0.0, 1.0, autoAccel);
+        launcherScheduler.schedule(blockerDownCommand);
+        launcherFaults.reset();
         //pressurizeLauncher();
         indexLauncherStatus();
-        displayStatusOnDashboard();
         //moveBlockerDown();
-        //placeTargetStatus("No Target Detected");
+        //placeTargetStatus(TARGET_NOT_DETECTED);
+        // feeds the Talons until the heading controller's first tick, which
+        // wins over this at the default priority
+        mecDrive(0.0, 0.0, 0.0);
+        applyOutputs();
+        executor->resync();
+        modeText = "Autonomous Enabled";
+        publishStatus();
     }
     void TeleopInit(void) {
-        dsLCD->Clear();
-        printMessage("Teleop Mode", 0);
-        gyro->Reset();
+        ScopedTiming timing(loopTimer, TIME_TELEOP_INIT);
+        modeText = "Teleop Mode";
+        // the heading carries on from autonomous
+        loopTimer->modeChanged();
+        headingController->disable();
+        gyroHistory.clear();
+        shotProfiler.start();
         timerLaunch->Start();
         timerLaunch->Reset();
+        driveScheduler.cancelAll();
+        launcherScheduler.cancelAll();
+        outputs.invalidate();
+        launching = false;
+        resetPower();
+        resetInputs();
+        readInputs();
         //pressurizeLauncher();
+        launcherFaults.reset();
         indexLauncherStatus();
-        initializeSolenoids(false);
-        indexLauncherStatus();
-        displayStatusOnDashboard();
-        //placeTargetStatus("No Target Detected");
+        driveScheduler.setDefaultCommand(driveSubsystem, teleopDriveCommand);
+        launcherScheduler.setButtonsEnabled(true);
+        driveScheduler.setButtonsEnabled(true);
+        //placeTargetStatus(TARGET_NOT_DETECTED);
+        applyOutputs();
+        executor->resync();
+        modeText = "Teleop Enabled";
+        publishStatus();
     }
     /********************************** Periodic Routines *************************************/
     void DisabledPeriodic(void) {
-        // no code
+        ScopedTiming timing(loopTimer, TIME_DISABLED_PERIODIC);
+        AllocationScope guard;
+        publishStatus();
     }
     void AutonomousPeriodic(void) {
-        dsLCD->Clear();
-        printMessage("Autonomous Enabled", 0);
-        indexLauncherStatus();
+        ScopedTiming timing(loopTimer, TIME_AUTONOMOUS_PERIODIC);
+        AllocationScope guard;
+        readInputs();
+        managePower();
         //if (launcherStatus == ABNORMAL_STATE)
             //initializeSolenoids();
-        //if (timerLaunch->Get() < launchDelay && launcherStatus == LAUNCHER_DOWN)
+        //if (!pressure.ready() && launcherStatus == LAUNCHER_DOWN)
         //  lockLauncher();
-        displayStatusOnDashboard();
         switch(autonomousState) {
         case 0:
-            toggleLED("on");
+            launcherScheduler.schedule(lightOnCommand);
             //pressurizeLauncher();
             //if (launcherStatus == LAUNCHER_READY)
             //  autonomousState = 1;
             //timerLaunch->Reset();
             timerAuto->Reset();
+            in.timerAuto = 0.0;
+            driveScheduler.schedule(followProfileCommand);
             autonomousState = 1;
             break;
         case 1:
             //launchBall();
             //if (launcherStatus == LAUNCHER_PRESSURIZING)
             //  autonomousState = 2;
-            while (timerAuto->Get() < 1.2)
-                mecDrive(0.0,1.0,0.0);
-            //timerAuto->Reset();
-            //while (timerAuto->Get() < 0.7)
-            //  mecDrive(0.0,-1.0,0.0);
-            //timerAuto->Reset();
-            //while (timerAuto->Get() < 0.7)
-            //  mecDrive(0.0,1.0,0.0);
-            stopRobot();
-            autonomousState = 2;
+            if (!followProfileCommand->isScheduled())
+                autonomousState = 2;
             break;
         case 2:
-            toggleLED("off");
+            launcherScheduler.schedule(lightOffCommand);
             //launcherStatus = LAUNCHER_READY;
             //launchBall(false);
             autonomousState = 3;
@@ -441,17 +1082,21 @@ public:
         default:
             break;
         }
+        executor->tick();
+        applyOutputs();
+        recordCycle(TelemetryRecord::AUTONOMOUS);
+        publishStatus();
     }
     void TeleopPeriodic(void) {
-        dsLCD->Clear();
-        printMessage("Teleop Enabled", 0);
-        teleopDrive();
-        indexLauncherStatus();
-        displayStatusOnDashboard();
-        teleopShooter();
-        //testSolenoids();
-        //printTargetStatus();
+        ScopedTiming timing(loopTimer, TIME_TELEOP_PERIODIC);
+        AllocationScope guard;
+        readInputs();
+        managePower();
+        executor->tick();
+        applyOutputs();
+        recordCycle(TelemetryRecord::TELEOP);
+        publishStatus();
     }
 };
      
-START_ROBOT_CLASS(TM_2014_ROBOT);
\ No newline at end of file
+START_ROBOT_CLASS(TM_2014_ROBOT);
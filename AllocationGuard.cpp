@@ -0,0 +1,32 @@
+#include "AllocationGuard.h"
+
+/* The replacement global operators that report to AllocationGuard. They are
+ * in their own file, linked into the robot programs only: the bench counts
+ * allocations with its own operator new, and the batch runs step many robot
+ * tasks at once.
+ */
+
+#if __cplusplus >= 201103L
+#define ALLOCATION_THROWS
+#define ALLOCATION_NOTHROW noexcept
+#else
+#define ALLOCATION_THROWS throw(std::bad_alloc)
+#define ALLOCATION_NOTHROW throw()
+#endif
+
+void *operator new(size_t size) ALLOCATION_THROWS {
+    AllocationGuard::allocating(size);
+    void *block = malloc(size ? size : 1);
+    if (!block)
+        throw std::bad_alloc();
+    return block;
+}
+void *operator new[](size_t size) ALLOCATION_THROWS {
+    return operator new(size);
+}
+void operator delete(void *block) ALLOCATION_NOTHROW {
+    free(block);
+}
+void operator delete[](void *block) ALLOCATION_NOTHROW {
+    free(block);
+}
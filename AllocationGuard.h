@@ -0,0 +1,95 @@
+#ifndef ALLOCATION_GUARD_H
+#define ALLOCATION_GUARD_H
+
+#include "WPILib.h"
+#include <taskLib.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+// What the guard does about an allocation in a periodic routine
+#define ALLOCATION_OFF 0
+#define ALLOCATION_COUNT 1
+#define ALLOCATION_ABORT 2
+
+// Counts by default; ALLOCATION_ABORT stops the robot at the first one
+// instead, and the bench and batch builds turn the guard off
+#ifndef ALLOCATION_GUARD
+#define ALLOCATION_GUARD ALLOCATION_COUNT
+#endif
+
+/* Catches heap allocations in the periodic routines, where the allocator's
+ * locking and the cRIO's fragmenting heap would show up as loop jitter.
+ *
+ * arm() is called at the end of RobotInit from the robot task; from then on
+ * every operator new the robot task makes inside an AllocationScope (one
+ * per periodic routine) is counted, or stops the program in abort mode.
+ * The init routines and the background tasks may still allocate: reports
+ * and NetworkTables need to. Nothing is counted unless AllocationGuard.cpp,
+ * which has the guarded operators, is linked into the program.
+ */
+class AllocationGuard {
+public:
+    static void arm(int mode) {
+        State &guard = state();
+        guard.task = taskIdSelf();
+        guard.mode = mode;
+    }
+    static void disarm() {
+        state().mode = ALLOCATION_OFF;
+    }
+    // From operator new
+    static void allocating(size_t size) {
+        State &guard = state();
+        if (guard.mode == ALLOCATION_OFF || guard.depth == 0 || taskIdSelf() != guard.task)
+            return;
+        guard.count++;
+        guard.bytes += size;
+        if (guard.mode == ALLOCATION_ABORT) {
+            fprintf(stderr, "allocation guard: %lu bytes allocated in a periodic routine\n",
+                    (unsigned long) size);
+            abort();
+        }
+    }
+    static long count() {
+        return state().count;
+    }
+    static void clearStats() {
+        state().count = 0;
+        state().bytes = 0;
+    }
+    static void dump(FILE *out = stdout) {
+        State &guard = state();
+        if (guard.mode == ALLOCATION_OFF)
+            return;
+        fprintf(out, "allocations in periodic routines: %ld (%ld bytes)\n", guard.count, guard.bytes);
+    }
+private:
+    friend class AllocationScope;
+    struct State {
+        int mode;
+        int task;
+        int depth;              // AllocationScopes open on the robot task
+        long count;
+        long bytes;
+    };
+    // Zeroed before any constructor runs, so operator new can use it from
+    // the start
+    static State &state() {
+        static State guard;
+        return guard;
+    }
+};
+
+// Marks a periodic routine for the guard, like ScopedTiming
+class AllocationScope {
+public:
+    AllocationScope() {
+        AllocationGuard::state().depth++;
+    }
+    ~AllocationScope() {
+        AllocationGuard::state().depth--;
+    }
+};
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef BUFFERED_LCD_H
+#define BUFFERED_LCD_H
+
+#include "WPILib.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Sits in front of the DriverStationLCD so a periodic routine can set its
+ * lines as often as it likes and still send at most one frame per cycle.
+ *
+ * Lines hold typed fields (fixed text or a labelled number) instead of
+ * formatted text. Nothing is formatted until flush(), and only lines whose
+ * field changed since the last flush are formatted and compared against
+ * what the driver station is already showing. If no line changed, nothing
+ * is sent.
+ *
+ * Text fields keep the pointer they are given, so pass string literals or
+ * other text that stays put.
+ */
+class BufferedLCD {
+public:
+    static const int kNumLines = DriverStationLCD::kNumLines;
+    static const int kLineLength = DriverStationLCD::kLineLength;
+
+    BufferedLCD(DriverStationLCD *driverStationLCD) {
+        lcd = driverStationLCD;
+        flushes = 0;
+        frames = 0;
+        saved = 0;
+        for (int i = 0; i < kNumLines; i++) {
+            setText(i, "");
+            shown[i] = pending[i];
+            memset(shownText[i], ' ', kLineLength);
+            shownText[i][kLineLength] = '\0';
+        }
+        sendAll = true;
+    }
+    // Blanks every line; lines set again before the flush are not resent
+    void clear() {
+        for (int i = 0; i < kNumLines; i++)
+            setText(i, "");
+    }
+    void setText(int line, const char *text) {
+        if (line < 0 || line >= kNumLines)
+            return;
+        pending[line].type = TEXT;
+        pending[line].text = text;
+        pending[line].value = 0;
+    }
+    // Shows "label: value" with the given number of decimals. The line only
+    // changes when the value changes at that precision.
+    void setNumber(int line, const char *label, float value, int decimals = 2) {
+        if (line < 0 || line >= kNumLines)
+            return;
+        long scale = 1;
+        for (int i = 0; i < decimals; i++)
+            scale *= 10;
+        pending[line].type = NUMBER;
+        pending[line].text = label;
+        pending[line].value = (long) (value * scale + (value < 0 ? -0.5 : 0.5));
+        pending[line].decimals = decimals;
+        pending[line].scale = scale;
+    }
+    // Sends the changed lines to the driver station with a single UpdateLCD()
+    void flush() {
+        int changed = 0;
+        for (int i = 0; i < kNumLines; i++) {
+            if (!sendAll && sameField(pending[i], shown[i]))
+                continue;
+            char text[kLineLength + 1];
+            format(pending[i], text);
+            shown[i] = pending[i];
+            if (!sendAll && memcmp(text, shownText[i], kLineLength) == 0)
+                continue;
+            memcpy(shownText[i], text, sizeof(text));
+            lcd->PrintfLine((DriverStationLCD::Line) i, "%s", text);
+            changed++;
+        }
+        sendAll = false;
+        flushes++;
+        saved += (kNumLines - changed) * kLineLength;
+        if (changed == 0)
+            return;
+        lcd->UpdateLCD();
+        frames++;
+    }
+    // Forces the next flush to send every line, e.g. after someone else
+    // wrote to the DriverStationLCD directly
+    void invalidate() {
+        sendAll = true;
+    }
+    long framesSent() {
+        return frames;
+    }
+    long bytesSaved() {
+        return saved;
+    }
+    void dump(FILE *out = stdout) {
+        if (flushes == 0)
+            return;
+        fprintf(out, "LCD: %ld frames in %ld flushes, %ld bytes not resent "
+                "(%.0f%% of every line every flush)\n", frames, flushes, saved,
+                100.0 * saved / (flushes * (double) (kNumLines * kLineLength)));
+    }
+private:
+    enum FieldType {TEXT, NUMBER};
+    struct Field {
+        FieldType type;
+        const char *text;
+        long value;
+        int decimals;
+        long scale;
+    };
+
+    static bool sameField(const Field &a, const Field &b) {
+        return a.type == b.type && a.text == b.text && a.value == b.value
+            && (a.type == TEXT || a.decimals == b.decimals);
+    }
+    static void format(const Field &field, char *text) {
+        int length;
+        if (field.type == TEXT) {
+            length = snprintf(text, kLineLength + 1, "%s", field.text);
+        }
+        else {
+            long whole = field.value / field.scale;
+            long fraction = field.value % field.scale;
+            const char *sign = "";
+            if (field.value < 0) {
+                sign = "-";
+                whole = -whole;
+                fraction = -fraction;
+            }
+            if (field.decimals > 0)
+                length = snprintf(text, kLineLength + 1, "%s: %s%ld.%0*ld", field.text, sign,
+                                  whole, field.decimals, fraction);
+            else
+                length = snprintf(text, kLineLength + 1, "%s: %s%ld", field.text, sign, whole);
+        }
+        if (length > kLineLength)
+            length = kLineLength;
+        memset(text + length, ' ', kLineLength - length);
+        text[kLineLength] = '\0';
+    }
+
+    DriverStationLCD *lcd;
+    Field pending[kNumLines];
+    Field shown[kNumLines];
+    char shownText[kNumLines][kLineLength + 1];
+    bool sendAll;
+    long flushes;
+    long frames;
+    long saved;
+};
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef COMMAND_SCHEDULER_H
+#define COMMAND_SCHEDULER_H
+
+#include "WPILib.h"
+
+class RobotCommand;
+
+/* A piece of the robot that only one command may use at a time (the drive,
+ * the launcher, the lock, ...). The default command, if any, runs whenever
+ * nothing else holds the subsystem.
+ */
+class RobotSubsystem {
+public:
+    explicit RobotSubsystem(const char *name) : name(name), current(0), defaultCommand(0) {}
+    const char *getName() {
+        return name;
+    }
+    RobotCommand *getCurrentCommand() {
+        return current;
+    }
+private:
+    friend class CommandScheduler;
+    const char *name;
+    RobotCommand *current;
+    RobotCommand *defaultCommand;
+};
+
+/* Something the robot does over one or more cycles. The scheduler calls
+ * initialize() once, then execute() every cycle until isFinished(), and
+ * end() with whether it was cut short. A command that returns false from
+ * isInterruptible() can't be cancelled by a button release or displaced by
+ * another command (only cancelAll() stops it), e.g. a shot in progress.
+ */
+class RobotCommand {
+public:
+    static const int kMaxRequirements = 4;
+
+    explicit RobotCommand(const char *name) : name(name), numRequirements(0), scheduled(false) {}
+    virtual ~RobotCommand() {}
+    void requires(RobotSubsystem *subsystem) {
+        if (numRequirements < kMaxRequirements)
+            requirements[numRequirements++] = subsystem;
+    }
+    const char *getName() {
+        return name;
+    }
+    bool isScheduled() {
+        return scheduled;
+    }
+    virtual void initialize() {}
+    virtual void execute() {}
+    virtual bool isFinished() {
+        return false;
+    }
+    virtual void end(bool interrupted) {}
+    virtual bool isInterruptible() {
+        return true;
+    }
+private:
+    friend class CommandScheduler;
+    const char *name;
+    RobotSubsystem *requirements[kMaxRequirements];
+    int numRequirements;
+    bool scheduled;
+};
+
+/* A command made of member functions of the robot class, so the robot's
+ * existing routines can be scheduled without a class per command. With no
+ * execute function the command is instant: initialize() is all it does.
+ * With execute but no finished test it runs until it is interrupted.
+ */
+template <class T>
+class MemberCommand : public RobotCommand {
+public:
+    typedef void (T::*Action)();
+    typedef bool (T::*Condition)();
+
+    MemberCommand(const char *name, T *owner, Action start, Action step = 0, Condition done = 0)
+        : RobotCommand(name), owner(owner), start(start), step(step), done(done),
+          stop(0), interruptible(0) {}
+    // Called when the command ends either way
+    void setEnd(Action action) {
+        stop = action;
+    }
+    // Asked before the command is cancelled or displaced
+    void setInterruptible(Condition condition) {
+        interruptible = condition;
+    }
+    virtual void initialize() {
+        if (start)
+            (owner->*start)();
+    }
+    virtual void execute() {
+        if (step)
+            (owner->*step)();
+    }
+    virtual bool isFinished() {
+        if (done)
+            return (owner->*done)();
+        return step == 0;
+    }
+    virtual void end(bool interrupted) {
+        if (stop)
+            (owner->*stop)();
+    }
+    virtual bool isInterruptible() {
+        return interruptible == 0 || (owner->*interruptible)();
+    }
+private:
+    T *owner;
+    Action start;
+    Action step;
+    Condition done;
+    Action stop;
+    Condition interruptible;
+};
+
+/* Runs commands against subsystems and starts them from button edges.
+ *
+ * Buttons are read from bit mask words like DriverStation::GetStickButtons()
+ * (bit 0 is button 1), usually the ones in the cycle's RobotSnapshot. run()
+ * compares each word with the last cycle's and only looks at the bindings of
+ * buttons that changed, so a cycle where nobody touches a button costs one
+ * compare per word plus the active commands, however many buttons are
+ * bound. Default commands are started when their subsystem is released, not
+ * by scanning the subsystems every cycle.
+ *
+ * Scheduling a command cancels whatever holds its subsystems, unless one of
+ * them can't be interrupted, in which case the new command doesn't start.
+ * Everything is in fixed tables sized by the constants below; nothing is
+ * allocated after the bindings are made.
+ */
+class CommandScheduler {
+public:
+    enum Trigger {WHEN_PRESSED, WHEN_RELEASED, WHILE_HELD, TOGGLE_WHEN_PRESSED};
+    static const int kMaxWords = 4;
+    static const int kButtonsPerWord = 32;
+    static const int kMaxBindings = 32;
+    static const int kMaxActive = 16;
+
+    CommandScheduler() {
+        numWords = 0;
+        numBindings = 0;
+        numActive = 0;
+        buttonsEnabled = true;
+    }
+    // Starts command on an edge of a button (1-32) in a button word. The word
+    // is read every run(), so it has to outlive the scheduler.
+    bool bind(const UINT32 *buttons, int button, Trigger trigger, RobotCommand *command) {
+        if (button < 1 || button > kButtonsPerWord || numBindings >= kMaxBindings)
+            return false;
+        int word = wordIndex(buttons);
+        if (word < 0)
+            return false;
+        Binding &binding = bindings[numBindings];
+        binding.trigger = trigger;
+        binding.command = command;
+        binding.next = words[word].first[button - 1];
+        words[word].first[button - 1] = numBindings++;
+        return true;
+    }
+    // Runs command whenever subsystem is free; 0 for none
+    void setDefaultCommand(RobotSubsystem *subsystem, RobotCommand *command) {
+        if (subsystem->defaultCommand && subsystem->defaultCommand != command)
+            cancel(subsystem->defaultCommand, true);
+        subsystem->defaultCommand = command;
+        if (command && !subsystem->current)
+            schedule(command);
+    }
+    // Starts command, displacing whatever holds its subsystems. Returns false
+    // if one of those can't be interrupted.
+    bool schedule(RobotCommand *command) {
+        if (command->scheduled)
+            return true;
+        if (numActive >= kMaxActive)
+            return false;
+        for (int i = 0; i < command->numRequirements; i++) {
+            RobotCommand *holder = command->requirements[i]->current;
+            if (holder && !holder->isInterruptible())
+                return false;
+        }
+        for (int i = 0; i < command->numRequirements; i++) {
+            RobotCommand *holder = command->requirements[i]->current;
+            if (holder)
+                finish(holder, true, false);
+        }
+        for (int i = 0; i < command->numRequirements; i++)
+            command->requirements[i]->current = command;
+        command->scheduled = true;
+        active[numActive++] = command;
+        command->initialize();
+        return true;
+    }
+    // Stops command if it allows it
+    void cancel(RobotCommand *command) {
+        cancel(command, false);
+    }
+    // Stops every command, interruptible or not, and forgets the defaults
+    // (they are set again for the new mode)
+    void cancelAll() {
+        for (int i = 0; i < numActive; i++) {
+            RobotCommand *command = active[i];
+            if (!command)
+                continue;
+            for (int j = 0; j < command->numRequirements; j++)
+                command->requirements[j]->defaultCommand = 0;
+            finish(command, true, false);
+        }
+        numActive = 0;
+    }
+    bool isScheduled(RobotCommand *command) {
+        return command->scheduled;
+    }
+    // Turns the button bindings on or off (e.g. off in autonomous). Either
+    // way, buttons already held at this point don't count as pressed.
+    void setButtonsEnabled(bool enabled) {
+        buttonsEnabled = enabled;
+        for (int i = 0; i < numWords; i++)
+            words[i].last = *words[i].buttons;
+    }
+    // Once per cycle, after the button words are updated
+    void run() {
+        if (buttonsEnabled)
+            for (int i = 0; i < numWords; i++)
+                pollButtons(words[i]);
+        // commands started during this pass run from the next cycle
+        int running = numActive;
+        for (int i = 0; i < running; i++) {
+            RobotCommand *command = active[i];
+            if (!command)
+                continue;
+            command->execute();
+            if (command->scheduled && command->isFinished())
+                finish(command, false, true);
+        }
+        compact();
+    }
+    int activeCount() {
+        int count = 0;
+        for (int i = 0; i < numActive; i++)
+            if (active[i])
+                count++;
+        return count;
+    }
+private:
+    struct Binding {
+        Trigger trigger;
+        RobotCommand *command;
+        int next;           // next binding on the same button, -1 at the end
+    };
+    struct ButtonWord {
+        const UINT32 *buttons;
+        UINT32 last;
+        int first[kButtonsPerWord];
+    };
+
+    int wordIndex(const UINT32 *buttons) {
+        for (int i = 0; i < numWords; i++)
+            if (words[i].buttons == buttons)
+                return i;
+        if (numWords >= kMaxWords)
+            return -1;
+        ButtonWord &word = words[numWords];
+        word.buttons = buttons;
+        word.last = *buttons;
+        for (int i = 0; i < kButtonsPerWord; i++)
+            word.first[i] = -1;
+        return numWords++;
+    }
+    void pollButtons(ButtonWord &word) {
+        UINT32 now = *word.buttons;
+        UINT32 changed = now ^ word.last;
+        word.last = now;
+        while (changed) {
+            int bit = __builtin_ctz(changed);
+            changed &= changed - 1;
+            bool pressed = (now >> bit) & 1;
+            for (int i = word.first[bit]; i >= 0; i = bindings[i].next)
+                fire(bindings[i], pressed);
+        }
+    }
+    void fire(Binding &binding, bool pressed) {
+        switch (binding.trigger) {
+        case WHEN_PRESSED:
+            if (pressed)
+                schedule(binding.command);
+            break;
+        case WHEN_RELEASED:
+            if (!pressed)
+                schedule(binding.command);
+            break;
+        case WHILE_HELD:
+            if (pressed)
+                schedule(binding.command);
+            else
+                cancel(binding.command);
+            break;
+        case TOGGLE_WHEN_PRESSED:
+            if (!pressed)
+                break;
+            if (binding.command->scheduled)
+                cancel(binding.command);
+            else
+                schedule(binding.command);
+            break;
+        }
+    }
+    void cancel(RobotCommand *command, bool force) {
+        if (!command->scheduled || (!force && !command->isInterruptible()))
+            return;
+        finish(command, true, true);
+    }
+    // Takes command off the active list and releases its subsystems, which
+    // go to their default commands unless another command is taking them
+    void finish(RobotCommand *command, bool interrupted, bool startDefaults) {
+        command->scheduled = false;
+        for (int i = 0; i < numActive; i++)
+            if (active[i] == command)
+                active[i] = 0;
+        for (int i = 0; i < command->numRequirements; i++)
+            if (command->requirements[i]->current == command)
+                command->requirements[i]->current = 0;
+        command->end(interrupted);
+        if (!startDefaults)
+            return;
+        for (int i = 0; i < command->numRequirements; i++) {
+            RobotSubsystem *subsystem = command->requirements[i];
+            if (subsystem->defaultCommand && subsystem->defaultCommand != command && !subsystem->current)
+                schedule(subsystem->defaultCommand);
+        }
+    }
+    void compact() {
+        int kept = 0;
+        for (int i = 0; i < numActive; i++)
+            if (active[i])
+                active[kept++] = active[i];
+        numActive = kept;
+    }
+
+    ButtonWord words[kMaxWords];
+    int numWords;
+    bool buttonsEnabled;
+    Binding bindings[kMaxBindings];
+    int numBindings;
+    RobotCommand *active[kMaxActive];
+    int numActive;
+};
+
+#endif
@@ -1,4 +1,11 @@
 #include "WPILib.h" // This imports the WPI Library, which includes (almost) everything we need to program the robot
+#include "RobotCore.h" // Drive, controller, gyro and LCD set up from a configuration
+#include "MotionProfile.h" // Precomputed autonomous paths
+#include "BufferedLCD.h" // Sends the LCD at most once per loop
+#include "LoopTimer.h" // Measures how long each routine takes
+#include "HeadingController.h" // Gyro PID that runs on its own thread
+#include "InputShaper.h" // Deadband, expo and slew limits for the sticks
+#include "AllocationGuard.h" // Counts heap allocations in the periodic routines
 
 /* This is the skeleton of the IterativeRobot program. It is basically a series of functions
  * that the dashboard runs at specified times. Init functions only run once each time it's called,
@@ -6,153 +13,218 @@
  * Teleop, etc.).
  */
 
-class TM_2013_Robot : public IterativeRobot
+// Mecanum drive test robot: Talons on PWM 1-4, controller on port 1, gyro on analog 1,
+// wheel encoders on digital 3-10
+struct TM_2013_Config {
+	static const DriveType kDriveType = MECANUM_DRIVE;
+	static const UINT32 kFrontLeftWheel = 1;
+	static const UINT32 kRearLeftWheel = 3;
+	static const UINT32 kFrontRightWheel = 2;
+	static const UINT32 kRearRightWheel = 4;
+	static const bool kInvertFrontLeft = false;
+	static const bool kInvertRearLeft = false;
+	static const bool kInvertFrontRight = true;
+	static const bool kInvertRearRight = true;
+	static const UINT32 kControllerPort = 1;
+	static const bool kHasGyro = true;
+	static const UINT32 kGyroChannel = 1;
+	static const bool kHasEncoders = true;
+	static const UINT32 kFrontLeftEncoderA = 3;
+	static const UINT32 kFrontLeftEncoderB = 4;
+	static const UINT32 kRearLeftEncoderA = 5;
+	static const UINT32 kRearLeftEncoderB = 6;
+	static const UINT32 kFrontRightEncoderA = 7;
+	static const UINT32 kFrontRightEncoderB = 8;
+	static const UINT32 kRearRightEncoderA = 9;
+	static const UINT32 kRearRightEncoderB = 10;
+	static const UINT32 kEncoderPulses = 360;
+	static const UINT32 kWheelDiameterMm = 152;
+};
+
+class TM_2013_Robot : public RobotCore<TM_2013_Config>
 {
 	// Declare robot variables here
-	Talon* frontLeftWheel;
-	Talon* frontRightWheel;
-	Talon* backLeftWheel;
-	Talon* backRightWheel;
-
-	Joystick* controller;
-	RobotDrive* tmRobotDrive;
+	InputShaper controllerShaper;
+	float axes[InputShaper::kNumAxes + 1]; // this loop's shaped controller axes
 
 	Timer* timer;
-	DriverStationLCD *dsLCD;
 
-	Gyro* gyro;
+	// Loop timing channels, added to loopTimer in this order
+	enum Timing {TIME_ROBOT_INIT, TIME_DISABLED_INIT, TIME_AUTONOMOUS_INIT, TIME_TELEOP_INIT,
+				 TIME_DISABLED_PERIODIC, TIME_AUTONOMOUS_PERIODIC, TIME_TELEOP_PERIODIC};
+	LoopTimer* loopTimer;
+	Notifier* timingPublisher; // puts the loop timing on NetworkTables, off the robot task
 
-	static const int A				 	= 1;
-	static const int B 				 	= 2;
-	static const int X 				 	= 3;
-	static const int Y 				 	= 4;
-	static const int LEFT_BUMPER  	    = 5;
-	static const int RIGHT_BUMPER 		= 6;
-	static const int BACK 			    = 7;
-	static const int HOME			    = 8;
-	static const int LEFT_ANALOG_PRESS  = 9;
-	static const int RIGHT_ANALOG_PRESS = 10;
+	MotionProfile autoProfile; // the autonomous path, built in AutonomousInit
+	float autoAccel;
+	float autoDriveTime;
+	float autoSpeed;
+	float autoPause;
+	static const int kAutoRepeats = 4; // drive and stop this many times, about 13 s
 
 public:
 	// Initialize robot variables here
 	TM_2013_Robot(void) {
-		frontLeftWheel = new Talon(1);
-		frontRightWheel = new Talon(2);
-		backLeftWheel = new Talon(3);
-		backRightWheel = new Talon(4);
-
-		controller = new Joystick(1);
-
-		gyro = new Gyro(1);
-
-		tmRobotDrive = new RobotDrive(frontLeftWheel, backLeftWheel, frontRightWheel, backRightWheel);
-
-		/// invert all the motors
-		tmRobotDrive->SetInvertedMotor(tmRobotDrive->kFrontRightMotor,true);
-		tmRobotDrive->SetInvertedMotor(tmRobotDrive->kRearRightMotor,true);
+		controllerShaper.configure(XBOX_LEFT_Y, 0.15, 0.3, 6.0, true); // forward
+		controllerShaper.configure(XBOX_TRIGGERS, 0.1, 0.3, 6.0); // strafe
+		controllerShaper.configure(XBOX_RIGHT_X, 0.15, 0.3, 8.0); // rotation
 
 		timer = new Timer();
-		dsLCD = DriverStationLCD::GetInstance();
+
+		loopTimer = new LoopTimer();
+		loopTimer->addChannel("RobotInit");
+		loopTimer->addChannel("DisabledInit");
+		loopTimer->addChannel("AutonomousInit");
+		loopTimer->addChannel("TeleopInit");
+		loopTimer->addChannel("DisabledPeriodic", true);
+		loopTimer->addChannel("AutonomousPeriodic", true);
+		loopTimer->addChannel("TeleopPeriodic", true);
+		timingPublisher = new Notifier(TM_2013_Robot::publishTiming, this);
+
+		loadAutonomousSettings();
 	}
 
 	/********************************** Command Functions *************************************/
 	// Define command functions here
-	void tankDrive(float leftSpeed, float rightSpeed) {
-		tmRobotDrive->TankDrive(leftSpeed,rightSpeed);
-	}
-	void mecDrive(float x, float y, float rotation) {
-		tmRobotDrive->MecanumDrive_Cartesian(x, y, rotation);
-	}
-	void stopRobot() {
-		tankDrive(0.0,0.0);
-	}
-	void printMessage(char* message, char lineNum) {
-		dsLCD->PrintfLine((DriverStationLCD::Line) lineNum, message);
-		dsLCD->UpdateLCD();
-	}
-	void driveStraight(float time, float speed) {
-		while (timer->Get() < time) {
-			float angle = gyro->GetAngle();
-			leftSpeed  = speed-(angle/50.0);
-			rightSpeed = speed+(angle/50.0);
-			// make sure motor is in range [-1.0,1.0]
-			if (leftSpeed < 0.0) {
-				leftSpeed = max(leftSpeed,-1.0);
-			}
-			if (leftSpeed > 0.0) {
-				leftSpeed = min(leftSpeed,1.0);
-			}
-			if (rightSpeed < 0.0) {
-				rightSpeed = max(rightSpeed,-1.0);
-			}
-			if (leftSpeed > 0.0) {
-				rightSpeed = min(rightSpeed,1.0);
-			}
-			tankDrive(leftSpeed, rightSpeed);
-		}
-		stopRobot();
+	// The table puts allocate, so they run on the Notifier's thread rather
+	// than in a periodic routine
+	static void publishTiming(void *robot) {
+		((TM_2013_Robot *) robot)->loopTimer->publish(0.0);
 	}
-	void turnRight(float angle, float rotationSpeed) {
-		gyro->Reset();
-		while(gyro->GetAngle() < angle){
-			mecDrive(0.0, 0.0, rotationSpeed);
+	// Reads and shapes every controller axis once for this loop
+	void readAxes() {
+		for (int axis = 1; axis <= InputShaper::kNumAxes; axis++) {
+			axes[axis] = controller->GetRawAxis(axis);
 		}
-		stopRobot();
+		controllerShaper.apply(axes, Timer::GetFPGATimestamp());
+	}
+	// Adds a straight drive to the autonomous path (does not move the robot yet);
+	// false if the path is full
+	bool driveStraight(float time, float speed) {
+		return autoProfile.addSegment(0.0, time*speed, 0.0, speed, autoAccel);
+	}
+	// Adds a turn in place to the autonomous path
+	bool turnRight(float angle, float rotationSpeed) {
+		return autoProfile.addSegment(0.0, 0.0, angle, rotationSpeed, autoAccel);
+	}
+	// The autonomous path and the gains that keep its heading, from the
+	// preferences file so they can be tuned without a rebuild
+	void loadAutonomousSettings() {
+		Preferences *prefs = Preferences::GetInstance();
+		autoDriveTime = prefs->GetFloat("AutoDriveTime", 2.0);
+		autoSpeed = prefs->GetFloat("AutoSpeed", 0.5);
+		autoPause = prefs->GetFloat("AutoPause", 1.0);
+		autoAccel = prefs->GetFloat("AutoAccel", 2.0);
+		headingController->setGains(prefs->GetFloat("HeadingP", 0.02), prefs->GetFloat("HeadingI", 0.01),
+									prefs->GetFloat("HeadingD", 0.001));
+	}
+	// Adds a stop to the autonomous path
+	bool pause(float time) {
+		return autoProfile.addPause(time);
+	}
+	// Gives one tick of the autonomous path to the heading controller, which
+	// drives it from its own thread; this loop leaves the drive alone until
+	// the controller is disabled
+	void followProfile(float time) {
+		const ProfileSample& sample = autoProfile.sampleAt(time);
+		headingController->setDrive(sample.x, sample.y);
+		headingController->holdHeading(sample.heading, sample.rotation);
 	}
 
-	//driveStraight(10.0);
+	// Where the pose estimator thinks the robot is, on lines 4 and 5; line 6
+	// is for messages like "Button A works"
+	void showPose() {
+		RobotPose pose;
+		if (poseEstimator->latest(pose)) {
+			lcd->setNumber(DriverStationLCD::kUser_Line4, "Field x", pose.x);
+			lcd->setNumber(DriverStationLCD::kUser_Line5, "Field y", pose.y);
+		}
+	}
 
 	/********************************** Init Routines *****************************************/
 	// Runs once when the robot is turned on
 	void RobotInit(void) {
-
+		ScopedTiming timing(loopTimer, TIME_ROBOT_INIT);
+		timingPublisher->StartPeriodic(1.0);
+		AllocationGuard::arm(ALLOCATION_GUARD); // from here on the periodic routines shouldn't allocate
 	}
 	// Runs once when the robot is disabled
 	void DisabledInit(void) {
-
+		ScopedTiming timing(loopTimer, TIME_DISABLED_INIT);
+		headingController->disable();
+		stopRobot();
+		if (!loopTimer->empty()) {
+			loopTimer->dump(); // print how the last match went
+			AllocationGuard::dump();
+			lcd->dump();
+			gyro->dump();
+		}
+		loopTimer->modeChanged();
 	}
 	// Runs once when autonomous mode is initialized
 	void AutonomousInit(void) {
+		ScopedTiming timing(loopTimer, TIME_AUTONOMOUS_INIT);
 		timer->Reset();
 		timer->Start();
-		gyro->Reset();
+		zeroHeading();
+		loopTimer->reset();
+		AllocationGuard::clearStats();
+		loadAutonomousSettings();
+		stopRobot(); // feeds the Talons until the heading controller's first tick
+		headingController->enable();
+		autoProfile.clear();
+		// drive forwards at half speed for about two seconds, then stop for a
+		// second (unless the preferences say otherwise), over and over like
+		// the old timed routine
+		bool fits = true;
+		for (int i = 0; i < kAutoRepeats && fits; i++) {
+			fits = driveStraight(autoDriveTime, autoSpeed) && pause(autoPause);
+		}
+		if (!fits) {
+			printf("autonomous path is longer than %d samples; it stops short\n", MotionProfile::kMaxSamples);
+		}
 	}
 	// Runs once when teleop mode is initialized
 	void TeleopInit(void) {
-		gyro->Reset();
+		ScopedTiming timing(loopTimer, TIME_TELEOP_INIT);
+		headingController->disable(); // the heading carries on from autonomous
+		loopTimer->modeChanged();
+		controllerShaper.reset(); // the sticks slew up from zero again
 	}
 
 	/********************************** Periodic Routines *************************************/
 	// Runs while the robot is disabled
 	void DisabledPeriodic(void) {
-
+		ScopedTiming timing(loopTimer, TIME_DISABLED_PERIODIC);
+		AllocationScope guard;
 	}
 	// Runs while the robot is in autonomous mode (after being initialized)
 	void AutonomousPeriodic(void) {
+		ScopedTiming timing(loopTimer, TIME_AUTONOMOUS_PERIODIC);
+		AllocationScope guard;
 		printMessage("HI I am in autonimous mode", 0); // print this messsage on the first line
-		dsLCD->Printf(DriverStationLCD::kUser_Line2, 1, "Time: %f", timer->Get()); // print the elapsed time
-		dsLCD->Printf(DriverStationLCD::kUser_Line3, 1, "Angle: %f", gyro->GetAngle());
-		if (timer->Get() < 2.0) { // for two seconds...
-			mecDrive(0.0,0.5,0.0); // drive forwards at half speed
-		}
-		else {
-			Wait(1.0); // pause the code for one second
-			timer->Reset(); // reset the timer
-		}
-		dsLCD->UpdateLCD();
+		lcd->setNumber(DriverStationLCD::kUser_Line2, "Time", timer->Get(), 1); // print the elapsed time
+		lcd->setNumber(DriverStationLCD::kUser_Line3, "Angle", gyro->getAngle());
+		followProfile(timer->Get()); // drive this tick's part of the path (stops at the end)
+		showPose();
+		lcd->flush(); // send anything that changed this loop
 	}
 	// Runs while the robot is teleop mode (after being initialized)
 	void TeleopPeriodic(void) {
-		float speed = -controller->GetRawAxis(2);
-		float rotation = controller->GetRawAxis(4);
-		float strafe = controller->GetRawAxis(3);
-		mecDrive(strafe, speed, rotation);
-		dsLCD->Printf(DriverStationLCD::kUser_Line2, 2, "Angle: %f", gyro->GetAngle());
-		if(controller->GetRawButton(A)){
+		ScopedTiming timing(loopTimer, TIME_TELEOP_PERIODIC);
+		AllocationScope guard;
+		readAxes();
+		float speed = axes[XBOX_LEFT_Y];
+		float rotation = axes[XBOX_RIGHT_X];
+		float strafe = axes[XBOX_TRIGGERS];
+		driveRobot(strafe, speed, rotation);
+		lcd->setNumber(DriverStationLCD::kUser_Line2, "Angle", gyro->getAngle());
+		if(controller->GetRawButton(XBOX_A)){
 			printMessage("Button A works",5);
-			gyro->Reset();
+			zeroHeading();
 		}
-		dsLCD->UpdateLCD();
+		showPose();
+		lcd->flush(); // send anything that changed this loop
 	}
 };
 
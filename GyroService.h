@@ -0,0 +1,277 @@
+#ifndef GYRO_SERVICE_H
+#define GYRO_SERVICE_H
+
+#include "WPILib.h"
+#include <math.h>
+#include <stdio.h>
+
+/* The gyro, usable as soon as it is constructed.
+ *
+ * WPILib's Gyro holds up its constructor for five seconds while it measures
+ * the sensor's output at rest (the bias), and only Reset() zeroes it. This
+ * does the same integration on the analog accumulator, but starts from the
+ * bias and scale saved in the calibration file, or the part's nominal 2.5 V
+ * and 7 mV per deg/s if there is none, and keeps measuring the bias on its
+ * own Notifier while the robot is disabled and holding still.
+ *
+ * Every window (half a second) the average output since the last one is a
+ * reading of the bias. A window that agrees with the one before is still;
+ * a long enough run of still windows replaces the bias and, once it has
+ * been measured for saveTime and has moved, is written back to the file.
+ * A new bias or scale only changes the angle from then on.
+ *
+ * getAngle() is the heading since zeroHeading(), which only moves an offset.
+ * totalAngle() is everything turned since construction and never jumps, for
+ * estimators that keep their own heading.
+ */
+class GyroService {
+public:
+    static const UINT32 kOversampleBits = 10;
+    static const UINT32 kAverageBits = 0;
+    static const UINT32 kSamplesPerSecond = 50;
+
+    // A null calibrationFile neither loads nor saves
+    GyroService(UINT32 channel, const char *calibrationFile = 0, double windowPeriod = 0.5) {
+        path = calibrationFile;
+        window = windowPeriod;
+        steadyRate = 0.2;
+        maxBiasError = 3.0;
+        firstTime = 2.0;
+        settleTime = 5.0;
+        saveTime = 10.0;
+        saveInterval = 60.0;
+        saveChange = 0.01;
+
+        analog = new AnalogChannel(channel);
+        analog->SetAverageBits(kAverageBits);
+        analog->SetOversampleBits(kOversampleBits);
+        analog->GetModule()->SetSampleRate(kSamplesPerSecond * (1 << (kAverageBits + kOversampleBits)));
+        voltsPerCount = analog->GetLSBWeight() * 1e-9 / (1 << kOversampleBits);
+        analog->InitAccumulator();
+        analog->SetAccumulatorDeadband(0);
+
+        sensitivity = 0.007;
+        bias = (2.5 + analog->GetOffset() * 1e-9) / voltsPerCount;
+        loaded = load();
+        measured = false;
+        savedBias = bias;
+        baseAngle = 0.0;
+        headingOffset = 0.0;
+        setCenter();
+        analog->ResetAccumulator();
+
+        primed = false;
+        lastValue = 0;
+        lastCount = 0;
+        haveLevel = false;
+        lastLevel = 0.0;
+        clearStill();
+        updates = 0;
+        saves = 0;
+        lastSave = 0.0;
+
+        notifier = new Notifier(GyroService::update, this);
+        notifier->StartPeriodic(window);
+    }
+    virtual ~GyroService() {
+        notifier->Stop();
+        delete notifier;
+        delete analog;
+    }
+    // Degrees since zeroHeading()
+    float getAngle() {
+        Synchronized sync(lock);
+        return (float) (integrated() - headingOffset);
+    }
+    // Degrees turned since construction
+    double totalAngle() {
+        Synchronized sync(lock);
+        return integrated();
+    }
+    // Makes the present heading read heading; the sensor carries on
+    void zeroHeading(float heading = 0.0) {
+        Synchronized sync(lock);
+        headingOffset = integrated() - heading;
+    }
+    // From the data sheet or a measured turn; saved with the bias
+    void setSensitivity(double voltsPerDegreePerSecond) {
+        {
+            Synchronized sync(lock);
+            fold();
+            sensitivity = voltsPerDegreePerSecond;
+        }
+        save();
+    }
+    // The bias came from the file or has been measured since
+    bool calibrated() {
+        Synchronized sync(lock);
+        return loaded || measured;
+    }
+    void dump(FILE *out = stdout) {
+        Synchronized sync(lock);
+        fprintf(out, "gyro: bias %.5f V (%s), %.4f V per deg/s; %ld bias updates, %ld saves\n",
+                bias * voltsPerCount, measured ? "measured" : loaded ? "from file" : "nominal",
+                sensitivity, updates, saves);
+    }
+private:
+    static void update(void *param) {
+        ((GyroService *) param)->refine();
+    }
+    void refine() {
+        bool disabled = DriverStation::GetInstance()->IsDisabled();
+        bool saveNow = false;
+        {
+            Synchronized sync(lock);
+            INT64 value;
+            UINT32 count;
+            analog->GetAccumulatorOutput(&value, &count);
+            if (!disabled) {
+                haveLevel = false;
+                clearStill();
+            }
+            else if (primed && count > lastCount) {
+                double samples = count - lastCount;
+                double level = center + (value - lastValue) / samples;
+                bool still = haveLevel && fabs(level - lastLevel) * voltsPerCount / sensitivity < steadyRate
+                             && (!(loaded || measured) || rate(level) < maxBiasError);
+                if (still) {
+                    stillSum += level * samples;
+                    stillSamples += samples;
+                }
+                else
+                    clearStill();
+                haveLevel = true;
+                lastLevel = level;
+
+                double stillTime = stillSamples / kSamplesPerSecond;
+                if (stillTime >= (loaded || measured ? settleTime : firstTime)) {
+                    double estimate = stillSum / stillSamples;
+                    measured = true;
+                    if (rate(estimate) > steadyRate / 10.0) {
+                        fold();
+                        bias = estimate;
+                        setCenter();
+                        updates++;
+                        value = 0;
+                        count = 0;
+                    }
+                }
+                double now = Timer::GetFPGATimestamp();
+                if (measured && stillTime >= saveTime && rate(savedBias) > saveChange
+                    && (saves == 0 || now - lastSave >= saveInterval)) {
+                    saveNow = true;
+                    lastSave = now;
+                }
+            }
+            primed = true;
+            lastValue = value;
+            lastCount = count;
+        }
+        if (saveNow)
+            save();
+    }
+    // deg/s the output reads at level counts, against the present bias
+    double rate(double level) {
+        return fabs(level - bias) * voltsPerCount / sensitivity;
+    }
+    double integrated() {
+        INT64 value;
+        UINT32 count;
+        analog->GetAccumulatorOutput(&value, &count);
+        return baseAngle + ((double) value - count * offset) * voltsPerCount / sensitivity / kSamplesPerSecond;
+    }
+    // Moves what has been turned so far into baseAngle and starts the
+    // accumulator again, before the bias or scale changes
+    void fold() {
+        baseAngle = integrated();
+        analog->ResetAccumulator();
+        primed = false;
+    }
+    // The accumulator takes whole counts off each sample; the fraction is
+    // taken off when the angle is worked out
+    void setCenter() {
+        center = (INT32) floor(bias + 0.5);
+        offset = bias - center;
+        analog->SetAccumulatorCenter(center);
+    }
+    void clearStill() {
+        stillSum = 0.0;
+        stillSamples = 0.0;
+    }
+    bool load() {
+        if (!path)
+            return false;
+        FILE *file = fopen(path, "r");
+        if (!file)
+            return false;
+        double fileBias, fileSensitivity;
+        bool ok = fscanf(file, "%lf %lf", &fileBias, &fileSensitivity) == 2
+                  && fileSensitivity > 0.0 && fileBias * voltsPerCount > 0.5 && fileBias * voltsPerCount < 4.5;
+        fclose(file);
+        if (ok) {
+            bias = fileBias;
+            sensitivity = fileSensitivity;
+        }
+        return ok;
+    }
+    // Writes the file with lock released, so the readers and the refining
+    // thread never wait on flash; fileLock keeps two saves in order
+    void save() {
+        if (!path)
+            return;
+        Synchronized saving(fileLock);
+        double savingBias, savingSensitivity;
+        {
+            Synchronized sync(lock);
+            savingBias = bias;
+            savingSensitivity = sensitivity;
+        }
+        FILE *file = fopen(path, "w");
+        if (!file)
+            return;
+        fprintf(file, "%.3f %.6f  bias (accumulator counts) and volts per deg/s\n", savingBias,
+                savingSensitivity);
+        fclose(file);
+        Synchronized sync(lock);
+        savedBias = savingBias;
+        saves++;
+    }
+
+    AnalogChannel *analog;
+    Notifier *notifier;
+    ReentrantSemaphore lock;    // the refining thread against the readers
+    ReentrantSemaphore fileLock; // one save at a time; taken before lock, never inside it
+    const char *path;
+    double window;
+    double steadyRate;          // deg/s two still windows may differ by
+    double maxBiasError;        // deg/s off a known bias that can't be standing still
+    double firstTime;           // s still before a first bias is taken
+    double settleTime;          // s still before a known bias is replaced
+    double saveTime;            // s still before a bias is saved
+    double saveInterval;        // s between saves
+    double saveChange;          // deg/s the bias must move by to be saved
+
+    double voltsPerCount;
+    double sensitivity;         // volts per deg/s
+    double bias;                // accumulator counts at rest
+    double savedBias;
+    bool loaded;
+    bool measured;
+    INT32 center;
+    double offset;
+    double baseAngle;           // turned before the accumulator was last reset
+    double headingOffset;
+
+    bool primed;
+    INT64 lastValue;
+    UINT32 lastCount;
+    bool haveLevel;
+    double lastLevel;
+    double stillSum;            // counts over the present still run
+    double stillSamples;
+    long updates;
+    long saves;
+    double lastSave;
+};
+
+#endif
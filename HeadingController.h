@@ -0,0 +1,241 @@
+#ifndef HEADING_CONTROLLER_H
+#define HEADING_CONTROLLER_H
+
+#include "WPILib.h"
+#include "GyroService.h"
+#include <math.h>
+
+/* PID on the gyro heading that runs on its own Notifier, so it samples and
+ * corrects at a fixed rate (200 Hz by default) no matter how often driver
+ * station packets arrive.
+ *
+ * The periodic loop hands over what it wants with setDrive() and
+ * holdHeading()/turnTo(); the controller thread picks those up under a
+ * semaphore on its next tick. Each tick sends its drive command to the
+ * output given to setOutput(), from the controller thread, so the drive is
+ * corrected at the controller's rate rather than the loop's. The output
+ * has to take commands from that thread: the 2014 robot gives it an
+ * OutputStage::DriveSource, the 2013 robot, whose loop leaves the drive
+ * alone while the controller is enabled, the drive mixer. The output is
+ * called with the controller's semaphore held, so once disable() returns no
+ * more commands come.
+ */
+class HeadingController {
+public:
+    HeadingController(GyroService *headingGyro, double updatePeriod = 0.005) {
+        gyro = headingGyro;
+        period = updatePeriod;
+        notifier = new Notifier(HeadingController::update, this);
+        kP = 0.02;
+        kI = 0.0;
+        kD = 0.0;
+        maxOutput = 1.0;
+        maxIntegral = 0.5;
+        tolerance = 2.0;
+        settleRate = 10.0;
+        fieldOriented = false;
+        enabled = false;
+        x = 0.0;
+        y = 0.0;
+        feedForward = 0.0;
+        setpoint = 0.0;
+        driveTo = 0;
+        send = 0;
+        reset();
+    }
+    virtual ~HeadingController() {
+        disable();
+        delete notifier;
+    }
+    void setGains(float p, float i, float d) {
+        Synchronized sync(lock);
+        kP = p;
+        kI = i;
+        kD = d;
+    }
+    // Largest rotation the controller will command, and the most the
+    // integral term alone may contribute
+    void setLimits(float output, float integral) {
+        Synchronized sync(lock);
+        maxOutput = output;
+        maxIntegral = integral;
+    }
+    // A turn is finished once within tolerance degrees and turning slower
+    // than rate degrees per second
+    void setTolerance(float degrees, float rate) {
+        Synchronized sync(lock);
+        tolerance = degrees;
+        settleRate = rate;
+    }
+    // Where each tick's drive command goes: anything with
+    // drive(x, y, rotation, gyroAngle) that may be called from the
+    // controller thread
+    template <class Drive>
+    void setOutput(Drive *drive) {
+        Synchronized sync(lock);
+        driveTo = drive;
+        send = &HeadingController::callDrive<Drive>;
+    }
+    // Hands the gyro angle out with the drive command so x/y are field relative
+    void setFieldOriented(bool oriented) {
+        Synchronized sync(lock);
+        fieldOriented = oriented;
+    }
+    // Translation to drive while holding the heading
+    void setDrive(float strafe, float forward) {
+        Synchronized sync(lock);
+        x = strafe;
+        y = forward;
+    }
+    // Holds a heading, adding a feed-forward rotation (e.g. from a profile)
+    void holdHeading(float heading, float rotation = 0.0) {
+        Synchronized sync(lock);
+        setpoint = heading;
+        feedForward = rotation;
+    }
+    // Turns in place to a heading; poll onTarget() to know when it is there
+    void turnTo(float heading) {
+        Synchronized sync(lock);
+        x = 0.0;
+        y = 0.0;
+        setpoint = heading;
+        feedForward = 0.0;
+        settled = false;
+    }
+    bool onTarget() {
+        Synchronized sync(lock);
+        return settled;
+    }
+    float getError() {
+        Synchronized sync(lock);
+        return error;
+    }
+    void enable() {
+        Synchronized sync(lock);
+        if (enabled)
+            return;
+        reset();
+        // standing still on the present heading until told otherwise
+        x = 0.0;
+        y = 0.0;
+        feedForward = 0.0;
+        setpoint = lastAngle;
+        enabled = true;
+        notifier->StartPeriodic(period);
+    }
+    // Stops the controller thread; the motors keep whatever it last sent
+    // them until the periodic code drives them
+    void disable() {
+        {
+            Synchronized sync(lock);
+            if (!enabled)
+                return;
+            enabled = false;
+        }
+        notifier->Stop();
+    }
+    bool isEnabled() {
+        Synchronized sync(lock);
+        return enabled;
+    }
+    // The drive command the last tick sent: the translation from
+    // setDrive(), the rotation that holds the heading and the gyro angle
+    // for a field oriented drive (0 otherwise), e.g. for telemetry. False
+    // while disabled; all zero until the first tick after enable().
+    bool getOutput(float &outX, float &outY, float &outRotation, float &outGyroAngle) {
+        Synchronized sync(lock);
+        if (!enabled)
+            return false;
+        outX = driveX;
+        outY = driveY;
+        outRotation = driveRotation;
+        outGyroAngle = driveGyroAngle;
+        return true;
+    }
+private:
+    static void update(void *param) {
+        ((HeadingController *) param)->calculate();
+    }
+    template <class Drive>
+    static void callDrive(void *drive, float x, float y, float rotation, float gyroAngle) {
+        ((Drive *) drive)->drive(x, y, rotation, gyroAngle);
+    }
+    void reset() {
+        integral = 0.0;
+        error = 0.0;
+        lastAngle = gyro->getAngle();
+        settled = false;
+        driveX = 0.0;
+        driveY = 0.0;
+        driveRotation = 0.0;
+        driveGyroAngle = 0.0;
+    }
+    void calculate() {
+        float angle = gyro->getAngle();
+        Synchronized sync(lock);
+        if (!enabled)
+            return;
+
+        error = setpoint - angle;
+        float rate = (angle - lastAngle) / period;
+        lastAngle = angle;
+
+        // derivative on the measurement so a new setpoint doesn't kick
+        float output = feedForward + kP * error + kI * integral - kD * rate;
+        float limited = output;
+        if (limited > maxOutput)
+            limited = maxOutput;
+        if (limited < -maxOutput)
+            limited = -maxOutput;
+
+        // anti-windup: only integrate while the output isn't pinned in the
+        // direction the error would push it further
+        if (limited == output || (output > 0) != (error > 0)) {
+            integral += error * period;
+            if (kI != 0.0) {
+                if (integral * kI > maxIntegral)
+                    integral = maxIntegral / kI;
+                if (integral * kI < -maxIntegral)
+                    integral = -maxIntegral / kI;
+            }
+        }
+        settled = fabs(error) < tolerance && fabs(rate) < settleRate;
+
+        driveX = x;
+        driveY = y;
+        driveRotation = limited;
+        driveGyroAngle = fieldOriented ? angle : 0.0;
+        if (driveTo)
+            send(driveTo, driveX, driveY, driveRotation, driveGyroAngle);
+    }
+
+    GyroService *gyro;
+    Notifier *notifier;
+    ReentrantSemaphore lock;
+    double period;
+    void *driveTo;              // setOutput()'s drive
+    void (*send)(void *drive, float x, float y, float rotation, float gyroAngle);
+
+    float kP, kI, kD;
+    float maxOutput;
+    float maxIntegral;
+    float tolerance;
+    float settleRate;
+    bool fieldOriented;
+    bool enabled;
+
+    float x, y;
+    float feedForward;
+    float setpoint;
+
+    float integral;
+    float error;
+    float lastAngle;
+    bool settled;
+
+    float driveX, driveY;       // the drive command the last tick sent
+    float driveRotation;
+    float driveGyroAngle;
+};
+
+#endif
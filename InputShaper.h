@@ -0,0 +1,98 @@
+#ifndef INPUT_SHAPER_H
+#define INPUT_SHAPER_H
+
+#include "WPILib.h"
+#include <math.h>
+
+/* Conditions every axis of one stick in a single pass per cycle.
+ *
+ * Each axis is configured once with a deadband (the rest of the travel is
+ * rescaled so the output still starts at zero and reaches full scale), an
+ * expo amount blending the linear response with a cubic one, an optional
+ * inversion and an optional slew rate limit in full-scale units per second.
+ *
+ * configure() bakes the deadband, expo and inversion into a lookup table,
+ * so apply() only interpolates between two table entries per axis and then
+ * limits the slew. Axes that were never configured pass straight through.
+ */
+class InputShaper {
+public:
+    static const int kNumAxes = 6;
+    static const int kTableSegments = 256;
+
+    InputShaper() {
+        for (int axis = 1; axis <= kNumAxes; axis++)
+            configure(axis, 0.0);
+        reset();
+    }
+    // Axes are numbered like GetRawAxis() (1-6)
+    void configure(int axis, float deadband, float expo = 0.0, float slewRate = 0.0,
+                   bool inverted = false) {
+        if (axis < 1 || axis > kNumAxes)
+            return;
+        Axis &shape = axes[axis];
+        shape.slewRate = slewRate;
+        for (int i = 0; i <= kTableSegments; i++) {
+            float value = 2.0 * i / kTableSegments - 1.0;
+            float magnitude = fabs(value);
+            if (magnitude <= deadband)
+                magnitude = 0.0;
+            else
+                magnitude = (magnitude - deadband) / (1.0 - deadband);
+            magnitude = (1.0 - expo) * magnitude + expo * magnitude * magnitude * magnitude;
+            if ((value < 0.0) != inverted)
+                magnitude = -magnitude;
+            shape.table[i] = magnitude;
+        }
+    }
+    // Forgets the slew limiter's last outputs, e.g. on a mode change, so
+    // the next cycle slews up from zero
+    void reset() {
+        for (int axis = 1; axis <= kNumAxes; axis++)
+            axes[axis].last = 0.0;
+        lastTime = -1.0;
+    }
+    // Shapes values[1..kNumAxes] in place; now is the time they were read at
+    void apply(float *values, double now) {
+        double elapsed = lastTime < 0.0 ? 0.0 : now - lastTime;
+        // one late packet after a pause mustn't let an axis jump to full scale
+        if (elapsed > 0.1)
+            elapsed = 0.1;
+        lastTime = now;
+        for (int axis = 1; axis <= kNumAxes; axis++) {
+            Axis &shape = axes[axis];
+            float value = lookup(shape.table, values[axis]);
+            if (shape.slewRate > 0.0) {
+                float step = shape.slewRate * elapsed;
+                if (value > shape.last + step)
+                    value = shape.last + step;
+                if (value < shape.last - step)
+                    value = shape.last - step;
+            }
+            shape.last = value;
+            values[axis] = value;
+        }
+    }
+private:
+    struct Axis {
+        float table[kTableSegments + 1];
+        float slewRate;
+        float last;
+    };
+
+    static float lookup(const float *table, float value) {
+        float position = (value + 1.0) * (kTableSegments / 2);
+        if (position <= 0.0)
+            return table[0];
+        if (position >= kTableSegments)
+            return table[kTableSegments];
+        int index = (int) position;
+        float fraction = position - index;
+        return table[index] + (table[index + 1] - table[index]) * fraction;
+    }
+
+    Axis axes[kNumAxes + 1];
+    double lastTime;
+};
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef LAUNCHER_FAULT_MANAGER_H
+#define LAUNCHER_FAULT_MANAGER_H
+
+#include "WPILib.h"
+#include <stdio.h>
+
+/* Notices when the launcher has got into a state it can't shoot from and
+ * takes it back to locked and charging, one timed step per cycle instead of
+ * with Wait().
+ *
+ * The launch solenoid drops the arm (kForward) or charges it (kReverse);
+ * the lock solenoid locks it (kForward) or lets it go (kReverse). The
+ * locking limit switch says whether the arm is down where the lock can
+ * hold it. update() is called every cycle with what the solenoids were
+ * told and what the switch reads, and keeps the time the lock and the
+ * switch last changed, so the switch is only judged once the mechanism has
+ * had time to move. The faults are:
+ *
+ *   unset          a solenoid has never been set (after power up), so
+ *                  nothing holds the arm
+ *   locked raised  the lock has been out for lockTravel but the arm isn't
+ *                  down: it came up before the lock or never came down.
+ *                  Only checked once setCheckLockedRaised() says the switch
+ *                  can be trusted.
+ *   unlocked       the lock has been in for longer than a shot takes, e.g.
+ *                  a shot stopped half way by a mode change, unless the
+ *                  driver put it there by hand
+ *
+ * start() plans the shortest way back from what is known at that point:
+ *
+ *   locked on a down arm       charge
+ *   dropped and down           lock, charge
+ *   otherwise                  release (if locked), drop, lock, charge
+ *
+ * The arm is dropped while the lock releases it, so a charged arm isn't
+ * fired.
+ *
+ * The drop step takes dropSettle. With a trusted switch it also waits for
+ * the switch and gives up after dropTimeout; a failed recovery isn't tried
+ * again for retryDelay.
+ * A recovery started with no fault (the reset button) is the full drop,
+ * lock, charge. run() moves the sequence on and launchOutput() and
+ * lockOutput() are what to hold the solenoids at (kOff to leave one
+ * alone).
+ *
+ * Each fault counts its occurrences, and recoveries their time from the
+ * fault to charging.
+ */
+class LauncherFaultManager {
+public:
+    enum Fault {FAULT_NONE, FAULT_UNSET, FAULT_LOCKED_RAISED, FAULT_UNLOCKED, kNumFaults};
+
+    LauncherFaultManager() {
+        lockTravel = 0.3;
+        dropSettle = 0.5;
+        dropTimeout = 2.0;
+        lockSettle = 1.0;
+        retryDelay = 2.0;
+        unlockedTimeout = 3.5;
+        checkLockedRaised = false;
+        lastLaunch = lastLock = DoubleSolenoid::kOff;
+        lastLoaderDown = false;
+        lockChangedAt = loaderChangedAt = 0.0;
+        primed = false;
+        reset();
+        clearStats();
+    }
+    // The step times: how long the lock takes to go in or out, the least
+    // time the arm is given to drop, the longest it is waited for, and how
+    // long the lock is given before the arm is charged against it
+    void setTimes(double lockTravelTime, double dropSettleTime, double dropTimeoutTime,
+                  double lockSettleTime) {
+        lockTravel = lockTravelTime;
+        dropSettle = dropSettleTime;
+        dropTimeout = dropTimeoutTime;
+        lockSettle = lockSettleTime;
+    }
+    // The longest the lock is out of the way in a shot, with a margin
+    void setUnlockedTimeout(double seconds) {
+        unlockedTimeout = seconds;
+    }
+    // Whether a locked arm the switch doesn't see down is a fault; off until
+    // the switch has been proven on the robot
+    void setCheckLockedRaised(bool check) {
+        checkLockedRaised = check;
+    }
+    // A new mode: nothing under way, and a failed recovery can be tried
+    // again at once. The change times are kept.
+    void reset() {
+        fault = FAULT_NONE;
+        faultSince = 0.0;
+        running = false;
+        step = kNumSteps;
+        stepShown = false;
+        retryAt = -1e9;
+    }
+    void clearStats() {
+        for (int i = 0; i < kNumFaults; i++)
+            occurrences[i] = 0;
+        started = 0;
+        recovered = 0;
+        failed = 0;
+        cutShort = 0;
+        totalTime = 0.0;
+        longestTime = 0.0;
+    }
+    // Once per cycle; the present fault. lockByHand is true while a manual
+    // lock command holds the lock, so a lock left in isn't a fault.
+    Fault update(double now, DoubleSolenoid::Value launch, DoubleSolenoid::Value lock, bool loaderDown,
+                 bool lockByHand = false) {
+        if (!primed || lock != lastLock)
+            lockChangedAt = now;
+        if (!primed || loaderDown != lastLoaderDown)
+            loaderChangedAt = now;
+        primed = true;
+        lastLaunch = launch;
+        lastLock = lock;
+        lastLoaderDown = loaderDown;
+
+        Fault present = FAULT_NONE;
+        if (launch == DoubleSolenoid::kOff || lock == DoubleSolenoid::kOff)
+            present = FAULT_UNSET;
+        else if (checkLockedRaised && lock == DoubleSolenoid::kForward && !loaderDown
+                 && now - lockChangedAt >= lockTravel && now - loaderChangedAt >= lockTravel)
+            present = FAULT_LOCKED_RAISED;
+        else if (lock == DoubleSolenoid::kReverse && !lockByHand && now - lockChangedAt >= unlockedTimeout)
+            present = FAULT_UNLOCKED;
+        if (present != fault) {
+            if (present != FAULT_NONE) {
+                occurrences[present]++;
+                faultSince = now;
+            }
+            fault = present;
+        }
+        return fault;
+    }
+    Fault getFault() {
+        return fault;
+    }
+    // A fault with nothing under way and no failed try too recently
+    bool needsRecovery(double now) {
+        return fault != FAULT_NONE && !running && now >= retryAt;
+    }
+    bool isRecovering() {
+        return running;
+    }
+    void start(double now) {
+        for (int i = 0; i < kNumSteps; i++)
+            planned[i] = false;
+        if (fault == FAULT_NONE) {
+            planned[STEP_DROP] = planned[STEP_LOCK] = true;
+            faultSince = now;
+        }
+        // locked on a down arm, it only needs charging
+        else if (!lastLoaderDown || lastLock != DoubleSolenoid::kForward) {
+            if (lastLaunch == DoubleSolenoid::kForward && lastLoaderDown)
+                planned[STEP_LOCK] = true;
+            else {
+                planned[STEP_RELEASE] = lastLock == DoubleSolenoid::kForward;
+                planned[STEP_DROP] = planned[STEP_LOCK] = true;
+            }
+        }
+        planned[STEP_CHARGE] = true;
+        running = true;
+        started++;
+        step = -1;
+        next(now);
+    }
+    // Moves on to the next step once this one is done; false once the
+    // recovery is over, either way. Every step's outputs are asked for in
+    // at least one call before it can finish.
+    bool run(double now, bool loaderDown) {
+        if (!running)
+            return false;
+        double elapsed = now - stepStart;
+        bool done = false;
+        switch (stepShown ? step : -1) {
+        case STEP_RELEASE:
+            done = elapsed >= lockTravel;
+            break;
+        case STEP_DROP:
+            // an unproven switch could hold every recovery here
+            if (!checkLockedRaised) {
+                done = elapsed >= dropSettle;
+                break;
+            }
+            if (elapsed >= dropTimeout && !loaderDown) {
+                running = false;
+                failed++;
+                retryAt = now + retryDelay;
+                return false;
+            }
+            done = elapsed >= dropSettle && loaderDown;
+            break;
+        case STEP_LOCK:
+            done = elapsed >= lockSettle;
+            break;
+        case STEP_CHARGE:
+            done = true;
+            break;
+        default:
+            break;
+        }
+        stepShown = true;
+        if (done)
+            next(now);
+        if (step == kNumSteps) {
+            running = false;
+            recovered++;
+            double took = now - faultSince;
+            totalTime += took;
+            if (took > longestTime)
+                longestTime = took;
+        }
+        return running;
+    }
+    // The recovery was stopped from outside (a mode change)
+    void stop() {
+        if (running)
+            cutShort++;
+        running = false;
+        step = kNumSteps;
+    }
+    DoubleSolenoid::Value launchOutput() {
+        if (!running)
+            return DoubleSolenoid::kOff;
+        if (step == STEP_RELEASE || step == STEP_DROP)
+            return DoubleSolenoid::kForward;
+        if (step == STEP_CHARGE)
+            return DoubleSolenoid::kReverse;
+        return DoubleSolenoid::kOff;
+    }
+    DoubleSolenoid::Value lockOutput() {
+        if (!running)
+            return DoubleSolenoid::kOff;
+        if (step == STEP_RELEASE)
+            return DoubleSolenoid::kReverse;
+        if (step == STEP_LOCK)
+            return DoubleSolenoid::kForward;
+        return DoubleSolenoid::kOff;
+    }
+    static const char *faultName(int fault) {
+        static const char *names[kNumFaults] = {"none", "unset", "locked raised", "unlocked"};
+        return names[fault];
+    }
+    void dump(FILE *out = stdout) {
+        fprintf(out, "launcher faults: %ld unset, %ld locked raised, %ld unlocked; %ld recoveries "
+                "started, %ld done, %ld failed, %ld cut short\n", occurrences[FAULT_UNSET],
+                occurrences[FAULT_LOCKED_RAISED], occurrences[FAULT_UNLOCKED], started, recovered,
+                failed, cutShort);
+        if (recovered > 0)
+            fprintf(out, "  fault to charging: mean %.2f s, longest %.2f s\n",
+                    totalTime / recovered, longestTime);
+    }
+private:
+    enum Step {STEP_RELEASE, STEP_DROP, STEP_LOCK, STEP_CHARGE, kNumSteps};
+
+    void next(double now) {
+        do
+            step++;
+        while (step < kNumSteps && !planned[step]);
+        stepStart = now;
+        stepShown = false;
+    }
+
+    double lockTravel;          // s for the lock to go in or out
+    double dropSettle;          // s the arm is given to drop, at least
+    double dropTimeout;         // s before a drop that never reaches a trusted switch fails
+    double lockSettle;          // s the lock gets before the arm is charged
+    double retryDelay;          // s after a failed recovery before the next
+    double unlockedTimeout;     // s the lock may stay in
+    bool checkLockedRaised;     // the locking switch is trusted
+
+    DoubleSolenoid::Value lastLaunch;
+    DoubleSolenoid::Value lastLock;
+    bool lastLoaderDown;
+    double lockChangedAt;
+    double loaderChangedAt;
+    bool primed;
+
+    Fault fault;
+    double faultSince;
+    bool running;
+    bool planned[kNumSteps];
+    int step;
+    double stepStart;
+    bool stepShown;             // run() has returned with this step's outputs
+    double retryAt;
+
+    long occurrences[kNumFaults];
+    long started;
+    long recovered;
+    long failed;
+    long cutShort;
+    double totalTime;
+    double longestTime;
+};
+
+#endif
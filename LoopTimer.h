@@ -0,0 +1,235 @@
+#ifndef LOOP_TIMER_H
+#define LOOP_TIMER_H
+
+#include "WPILib.h"
+#include "NetworkTables/NetworkTable.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+/* Histogram of durations in microseconds with a fixed set of buckets: exact
+ * below 8 us, then 8 buckets per power of two (about 12% wide) up to over a
+ * minute. Recording only bumps a counter, so it never allocates.
+ */
+class LatencyHistogram {
+public:
+    static const int kSubBuckets = 8;
+    static const int kBuckets = 28 * kSubBuckets;
+
+    LatencyHistogram() {
+        reset();
+    }
+    void reset() {
+        memset(counts, 0, sizeof(counts));
+        total = 0;
+        sum = 0;
+        largest = 0;
+    }
+    void record(UINT32 micros) {
+        counts[bucketOf(micros)]++;
+        total++;
+        sum += micros;
+        if (micros > largest)
+            largest = micros;
+    }
+    long count() {
+        return total;
+    }
+    UINT32 max() {
+        return largest;
+    }
+    double mean() {
+        return total ? (double) sum / total : 0.0;
+    }
+    // Upper edge of the bucket holding the given fraction of samples
+    UINT32 percentile(double fraction) {
+        if (total == 0)
+            return 0;
+        long wanted = (long) (fraction * total + 0.5);
+        if (wanted < 1)
+            wanted = 1;
+        long seen = 0;
+        for (int i = 0; i < kBuckets; i++) {
+            seen += counts[i];
+            if (seen >= wanted) {
+                UINT32 edge = upperEdge(i);
+                return edge < largest ? edge : largest;
+            }
+        }
+        return largest;
+    }
+private:
+    static int bucketOf(UINT32 micros) {
+        if (micros < kSubBuckets)
+            return micros;
+        int msb = 31 - __builtin_clz(micros);
+        int bucket = (msb - 2) * kSubBuckets + ((micros >> (msb - 3)) & (kSubBuckets - 1));
+        return bucket < kBuckets ? bucket : kBuckets - 1;
+    }
+    static UINT32 upperEdge(int bucket) {
+        if (bucket < kSubBuckets)
+            return bucket;
+        int msb = bucket / kSubBuckets + 2;
+        int sub = bucket % kSubBuckets;
+        return ((UINT32) (kSubBuckets + sub + 1) << (msb - 3)) - 1;
+    }
+
+    long counts[kBuckets];
+    long total;
+    UINT64 sum;
+    UINT32 largest;
+};
+
+/* Times the robot's entry points and named steps inside them.
+ *
+ * Each channel has its own histogram. Channels marked periodic also count
+ * overruns (a call longer than the driver station packet period) and
+ * missed packets (a gap between calls of more than one period). start() and
+ * stop() only read the FPGA clock and bump counters; the summary is built
+ * when publish() or dump() is called.
+ */
+class LoopTimer {
+public:
+    static const int kMaxChannels = 16;
+
+    LoopTimer(const char *tableName = "Loop Timing", double packetPeriod = 0.02) {
+        table = NetworkTable::GetTable(tableName);
+        period = (UINT32) (packetPeriod * 1e6);
+        numChannels = 0;
+        lastPublish = 0;
+    }
+    // Channel names must stay put (string literals)
+    int addChannel(const char *name, bool periodic = false) {
+        if (numChannels == kMaxChannels)
+            return -1;
+        Channel &channel = channels[numChannels];
+        channel.name = name;
+        channel.periodic = periodic;
+        channel.started = 0;
+        channel.lastStart = 0;
+        channel.running = false;
+        channel.overruns = 0;
+        channel.missed = 0;
+        std::string prefix(name);
+        channel.keys[0] = prefix + " p50 ms";
+        channel.keys[1] = prefix + " p99 ms";
+        channel.keys[2] = prefix + " max ms";
+        channel.keys[3] = prefix + " overruns";
+        channel.keys[4] = prefix + " missed";
+        return numChannels++;
+    }
+    void start(int id) {
+        if (id < 0)
+            return;
+        Channel &channel = channels[id];
+        UINT32 now = GetFPGATime();
+        if (channel.periodic && channel.lastStart != 0) {
+            UINT32 gap = now - channel.lastStart;
+            if (gap > period + period / 2)
+                channel.missed += (gap + period / 2) / period - 1;
+        }
+        channel.started = now;
+        channel.lastStart = now;
+        channel.running = true;
+    }
+    void stop(int id) {
+        if (id < 0 || !channels[id].running)
+            return;
+        Channel &channel = channels[id];
+        UINT32 elapsed = GetFPGATime() - channel.started;
+        channel.histogram.record(elapsed);
+        if (channel.periodic && elapsed > period)
+            channel.overruns++;
+        channel.running = false;
+    }
+    // The gap before the first call in a new mode is not a missed packet
+    void modeChanged() {
+        for (int i = 0; i < numChannels; i++)
+            channels[i].lastStart = 0;
+    }
+    void reset() {
+        for (int i = 0; i < numChannels; i++) {
+            channels[i].histogram.reset();
+            channels[i].overruns = 0;
+            channels[i].missed = 0;
+            channels[i].lastStart = 0;
+        }
+    }
+    bool empty() {
+        for (int i = 0; i < numChannels; i++)
+            if (channels[i].histogram.count() > 0)
+                return false;
+        return true;
+    }
+    // Puts the summary on the table at most once per interval
+    void publish(double interval = 1.0) {
+        UINT32 now = GetFPGATime();
+        if (lastPublish != 0 && now - lastPublish < (UINT32) (interval * 1e6))
+            return;
+        lastPublish = now;
+        for (int i = 0; i < numChannels; i++) {
+            Channel &channel = channels[i];
+            table->PutNumber(channel.keys[0], channel.histogram.percentile(0.50) / 1000.0);
+            table->PutNumber(channel.keys[1], channel.histogram.percentile(0.99) / 1000.0);
+            table->PutNumber(channel.keys[2], channel.histogram.max() / 1000.0);
+            if (channel.periodic) {
+                table->PutNumber(channel.keys[3], channel.overruns);
+                table->PutNumber(channel.keys[4], channel.missed);
+            }
+        }
+    }
+    void dump(FILE *out = stdout) {
+        fprintf(out, "%-22s %8s %9s %9s %9s %9s %8s %8s\n", "loop timing", "calls",
+                "mean ms", "p50 ms", "p99 ms", "max ms", "overrun", "missed");
+        for (int i = 0; i < numChannels; i++) {
+            Channel &channel = channels[i];
+            if (channel.histogram.count() == 0)
+                continue;
+            fprintf(out, "%-22s %8ld %9.3f %9.3f %9.3f %9.3f", channel.name,
+                    channel.histogram.count(), channel.histogram.mean() / 1000.0,
+                    channel.histogram.percentile(0.50) / 1000.0,
+                    channel.histogram.percentile(0.99) / 1000.0,
+                    channel.histogram.max() / 1000.0);
+            if (channel.periodic)
+                fprintf(out, " %8ld %8ld\n", channel.overruns, channel.missed);
+            else
+                fprintf(out, "\n");
+        }
+    }
+private:
+    struct Channel {
+        const char *name;
+        bool periodic;
+        bool running;
+        UINT32 started;
+        UINT32 lastStart;
+        long overruns;
+        long missed;
+        LatencyHistogram histogram;
+        std::string keys[5];
+    };
+
+    NetworkTable *table;
+    UINT32 period;
+    UINT32 lastPublish;
+    Channel channels[kMaxChannels];
+    int numChannels;
+};
+
+// Times the rest of the enclosing scope on one channel
+class ScopedTiming {
+public:
+    ScopedTiming(LoopTimer *loopTimer, int channel) {
+        timer = loopTimer;
+        id = channel;
+        timer->start(id);
+    }
+    ~ScopedTiming() {
+        timer->stop(id);
+    }
+private:
+    LoopTimer *timer;
+    int id;
+};
+
+#endif
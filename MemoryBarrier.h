@@ -0,0 +1,18 @@
+#ifndef MEMORY_BARRIER_H
+#define MEMORY_BARRIER_H
+
+/* MEMORY_BARRIER() keeps the compiler and the CPU from moving loads and
+ * stores across it, for data handed between tasks without a lock.
+ *
+ * The cRIO's GCC 3.4 has no __sync builtins, so on PowerPC it is the sync
+ * instruction itself; elsewhere (the simulator) it is GCC's full barrier.
+ */
+#if defined(__PPC__) || defined(__powerpc__)
+#define MEMORY_BARRIER() __asm__ __volatile__ ("sync" : : : "memory")
+#elif defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define MEMORY_BARRIER() __sync_synchronize()
+#else
+#error "MemoryBarrier.h: no memory barrier for this compiler"
+#endif
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef MOTION_PROFILE_H
+#define MOTION_PROFILE_H
+
+#include <math.h>
+
+/* One tick of a precomputed autonomous path. x, y and rotation are the
+ * mecanum drive commands for the tick, heading is where the gyro should read.
+ */
+struct ProfileSample {
+    float x;
+    float y;
+    float rotation;
+    float heading;
+};
+
+/* Trapezoidal motion profiles built ahead of time (in AutonomousInit) and
+ * followed one sample per periodic call, so autonomous never has to spin in
+ * a while loop.
+ *
+ * Distances are in "drive-seconds": one second at full power covers 1.0,
+ * which is how the old timed routines were written. Headings are in gyro
+ * degrees and turnRate is how fast the robot turns at full rotation.
+ */
+class MotionProfile {
+public:
+    static const int kMaxSamples = 750;     // 15 seconds at 50 Hz
+
+    MotionProfile(float samplePeriod = 0.02, float fullTurnRate = 180.0) {
+        period = samplePeriod;
+        turnRate = fullTurnRate;
+        clear();
+    }
+    void clear() {
+        numSamples = 0;
+        heading = 0.0;
+        endSample.x = 0.0;
+        endSample.y = 0.0;
+        endSample.rotation = 0.0;
+        endSample.heading = 0.0;
+    }
+    // Moves (dx, dy) drive-seconds while turning dHeading degrees, speeding up
+    // at accel per second to no more than maxSpeed. Returns false if the
+    // segment does not fit.
+    bool addSegment(float dx, float dy, float dHeading, float maxSpeed, float accel) {
+        float length = sqrt(dx*dx + dy*dy);
+        float turn = fabs(dHeading) / turnRate;
+        float distance = length > turn ? length : turn;
+        if (distance <= 0.0 || maxSpeed <= 0.0 || accel <= 0.0)
+            return true;
+
+        // accelerate, cruise, decelerate; a triangle if there is no room to cruise
+        float peakSpeed = maxSpeed;
+        float accelTime = peakSpeed / accel;
+        if (peakSpeed * accelTime > distance) {
+            peakSpeed = sqrt(distance * accel);
+            accelTime = peakSpeed / accel;
+        }
+        float cruiseTime = (distance - peakSpeed * accelTime) / peakSpeed;
+        float totalTime = 2 * accelTime + cruiseTime;
+
+        int count = (int) ceil(totalTime / period);
+        if (numSamples + count > kMaxSamples)
+            return false;
+        for (int i = 0; i < count; i++) {
+            float t = i * period;
+            float speed, travelled;
+            if (t < accelTime) {
+                speed = accel * t;
+                travelled = 0.5 * accel * t * t;
+            }
+            else if (t < accelTime + cruiseTime) {
+                speed = peakSpeed;
+                travelled = 0.5 * peakSpeed * accelTime + peakSpeed * (t - accelTime);
+            }
+            else {
+                float left = totalTime - t;
+                speed = accel * left;
+                travelled = distance - 0.5 * accel * left * left;
+            }
+            ProfileSample &sample = samples[numSamples++];
+            sample.x = dx / distance * speed;
+            sample.y = dy / distance * speed;
+            sample.rotation = dHeading / turnRate / distance * speed;
+            sample.heading = heading + dHeading * travelled / distance;
+        }
+        heading += dHeading;
+        endSample.heading = heading;
+        return true;
+    }
+    // Holds still on the current heading
+    bool addPause(float seconds) {
+        int count = (int) ceil(seconds / period);
+        if (numSamples + count > kMaxSamples)
+            return false;
+        for (int i = 0; i < count; i++)
+            samples[numSamples++] = endSample;
+        return true;
+    }
+    int size() {
+        return numSamples;
+    }
+    float duration() {
+        return numSamples * period;
+    }
+    bool done(float time) {
+        return time >= duration();
+    }
+    // Sample for a time since the profile started; past the end the robot
+    // holds the final heading
+    const ProfileSample& sampleAt(float time) {
+        int i = (int) (time / period);
+        if (i < 0)
+            i = 0;
+        if (i >= numSamples)
+            return endSample;
+        return samples[i];
+    }
+private:
+    ProfileSample samples[kMaxSamples];
+    ProfileSample endSample;
+    int numSamples;
+    float period;
+    float turnRate;
+    float heading;
+};
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef OUTPUT_STAGE_H
+#define OUTPUT_STAGE_H
+
+#include "WPILib.h"
+#include <stdio.h>
+
+/* Collects the actuator commands made during a periodic call and writes
+ * them to the hardware once, at the end of the cycle, with apply().
+ *
+ * When several commands for the same actuator come in during a cycle, the
+ * one with the highest priority wins, and among equal priorities the last
+ * one. A write that wouldn't change what the hardware already has is
+ * dropped, except for the drive: the Talons' motor safety has to be fed, so
+ * an unchanged drive command is still sent once every keepalive period.
+ * The drive goes through the robot's DriveMixer (RobotCore.h), whichever
+ * drive type that is. The drive limit (the mixer's setMaxOutput()) is sent
+ * when it changes, and the drive command goes out again with it.
+ *
+ * A DriveSource lets another thread drive, e.g. the heading controller's
+ * Notifier at its own rate: each of its commands is written to the mixer
+ * straight away instead of at apply(), under a lock the stage's own drive
+ * writes take too, with the same keepalive. It loses to a drive command of
+ * a higher priority written within the last keepalive period, so a stop
+ * from the periodic loop holds.
+ *
+ * Each actuator counts the writes it applied, the ones it dropped as
+ * unchanged and the ones that lost to another command in the same cycle.
+ */
+class OutputStage {
+public:
+    enum Priority {PRIORITY_DEFAULT, PRIORITY_COMMAND, PRIORITY_SEQUENCE, PRIORITY_SAFETY};
+    static const int kMaxSolenoids = 8;
+    static const int kMaxRelays = 4;
+
+    // Drives from another thread at a fixed priority; see above
+    class DriveSource {
+    public:
+        DriveSource(OutputStage *stage, Priority priority) : stage(stage), priority(priority) {}
+        bool drive(float x, float y, float rotation, float gyroAngle) {
+            return stage->driveNow(x, y, rotation, gyroAngle, priority);
+        }
+    private:
+        OutputStage *stage;
+        Priority priority;
+    };
+
+    explicit OutputStage(double driveKeepalive = 0.05) {
+        keepalive = driveKeepalive;
+        numSolenoids = 0;
+        numRelays = 0;
+        mixer = 0;
+        driveCounts.name = "drive";
+        driveCounts.reset();
+        sourceCounts.name = "drive (other thread)";
+        sourceCounts.reset();
+        drivePending = false;
+        driveKnown = false;
+        lastDriveWrite = 0.0;
+        driveLimit = 1.0;
+        limitKnown = false;
+    }
+    int addSolenoid(DoubleSolenoid *solenoid, const char *name) {
+        if (numSolenoids >= kMaxSolenoids)
+            return -1;
+        SolenoidOutput &output = solenoids[numSolenoids];
+        output.solenoid = solenoid;
+        output.counts.name = name;
+        output.counts.reset();
+        output.pending = false;
+        output.known = false;
+        return numSolenoids++;
+    }
+    int addRelay(Relay *relay, const char *name) {
+        if (numRelays >= kMaxRelays)
+            return -1;
+        RelayOutput &output = relays[numRelays];
+        output.relay = relay;
+        output.counts.name = name;
+        output.counts.reset();
+        output.pending = false;
+        output.known = false;
+        return numRelays++;
+    }
+    // Any DriveMixer; the stage only keeps a pointer to it and two plain
+    // functions that call it
+    template <class Mixer>
+    void setDrive(Mixer *driveMixer) {
+        mixer = driveMixer;
+        mix = &OutputStage::callDrive<Mixer>;
+        limit = &OutputStage::callMaxOutput<Mixer>;
+    }
+    // Returns the value the solenoid will get this cycle, which is not the
+    // one asked for if a higher priority command got there first
+    DoubleSolenoid::Value setSolenoid(int id, DoubleSolenoid::Value value,
+                                      Priority priority = PRIORITY_DEFAULT) {
+        SolenoidOutput &output = solenoids[id];
+        if (request(output.counts, output.pending, output.priority, priority))
+            output.value = value;
+        return output.value;
+    }
+    Relay::Value setRelay(int id, Relay::Value value, Priority priority = PRIORITY_DEFAULT) {
+        RelayOutput &output = relays[id];
+        if (request(output.counts, output.pending, output.priority, priority))
+            output.value = value;
+        return output.value;
+    }
+    // Drive command for the mixer; false if a higher priority one already won
+    bool drive(float x, float y, float rotation, float gyroAngle,
+               Priority priority = PRIORITY_DEFAULT) {
+        if (!request(driveCounts, drivePending, drivePriority, priority))
+            return false;
+        driveValue[0] = x;
+        driveValue[1] = y;
+        driveValue[2] = rotation;
+        driveValue[3] = gyroAngle;
+        return true;
+    }
+    // Fraction of every drive output to use, including the heading
+    // controller's; stays until changed
+    void setDriveLimit(float limit) {
+        driveLimit = limit;
+    }
+    // Writes this cycle's winners and starts the next cycle
+    void apply(double now) {
+        for (int i = 0; i < numSolenoids; i++) {
+            SolenoidOutput &output = solenoids[i];
+            if (!output.pending)
+                continue;
+            output.pending = false;
+            if (output.known && output.value == output.applied) {
+                output.counts.suppressed++;
+                continue;
+            }
+            output.solenoid->Set(output.value);
+            output.applied = output.value;
+            output.known = true;
+            output.counts.applied++;
+        }
+        for (int i = 0; i < numRelays; i++) {
+            RelayOutput &output = relays[i];
+            if (!output.pending)
+                continue;
+            output.pending = false;
+            if (output.known && output.value == output.applied) {
+                output.counts.suppressed++;
+                continue;
+            }
+            output.relay->Set(output.value);
+            output.applied = output.value;
+            output.known = true;
+            output.counts.applied++;
+        }
+        Synchronized sync(driveLock);
+        if (mixer && (!limitKnown || driveLimit != appliedLimit)) {
+            limit(mixer, driveLimit);
+            appliedLimit = driveLimit;
+            limitKnown = true;
+            driveKnown = false;
+        }
+        if (drivePending && mixer)
+            writeDrive(now, driveValue, drivePriority, driveCounts);
+        drivePending = false;
+    }
+    // Forgets what the hardware was last given, so the next command for each
+    // actuator is written even if it looks unchanged. For when something
+    // else may have moved them (a mode change).
+    void invalidate() {
+        for (int i = 0; i < numSolenoids; i++)
+            solenoids[i].known = false;
+        for (int i = 0; i < numRelays; i++)
+            relays[i].known = false;
+        Synchronized sync(driveLock);
+        driveKnown = false;
+        limitKnown = false;
+    }
+    void dump(FILE *out = stdout) {
+        fprintf(out, "%-22s %9s %10s %10s\n", "outputs", "applied", "unchanged", "overridden");
+        for (int i = 0; i < numSolenoids; i++)
+            solenoids[i].counts.print(out);
+        for (int i = 0; i < numRelays; i++)
+            relays[i].counts.print(out);
+        if (mixer)
+            driveCounts.print(out);
+        if (sourceCounts.applied + sourceCounts.suppressed + sourceCounts.overridden > 0)
+            sourceCounts.print(out);
+    }
+private:
+    struct Counts {
+        const char *name;
+        long applied;
+        long suppressed;
+        long overridden;
+        void reset() {
+            applied = 0;
+            suppressed = 0;
+            overridden = 0;
+        }
+        void print(FILE *out) {
+            fprintf(out, "%-22s %9ld %10ld %10ld\n", name, applied, suppressed, overridden);
+        }
+    };
+    struct SolenoidOutput {
+        DoubleSolenoid *solenoid;
+        Counts counts;
+        bool pending;
+        Priority priority;
+        DoubleSolenoid::Value value;
+        bool known;
+        DoubleSolenoid::Value applied;
+    };
+    struct RelayOutput {
+        Relay *relay;
+        Counts counts;
+        bool pending;
+        Priority priority;
+        Relay::Value value;
+        bool known;
+        Relay::Value applied;
+    };
+
+    friend class DriveSource;
+
+    // Under driveLock
+    void writeDrive(double now, const float *value, Priority priority, Counts &counts) {
+        bool same = driveKnown;
+        for (int i = 0; i < 4; i++)
+            if (value[i] != driveApplied[i])
+                same = false;
+        if (same && now - lastDriveWrite < keepalive) {
+            counts.suppressed++;
+            return;
+        }
+        mix(mixer, value);
+        for (int i = 0; i < 4; i++)
+            driveApplied[i] = value[i];
+        driveKnown = true;
+        lastDriveWrite = now;
+        appliedPriority = priority;
+        counts.applied++;
+    }
+    bool driveNow(float x, float y, float rotation, float gyroAngle, Priority priority) {
+        double now = Timer::GetFPGATimestamp();
+        Synchronized sync(driveLock);
+        if (!mixer)
+            return false;
+        if (driveKnown && appliedPriority > priority && now - lastDriveWrite < keepalive) {
+            sourceCounts.overridden++;
+            return false;
+        }
+        float value[4] = {x, y, rotation, gyroAngle};
+        writeDrive(now, value, priority, sourceCounts);
+        return true;
+    }
+    template <class Mixer>
+    static void callDrive(void *driveMixer, const float *value) {
+        ((Mixer *) driveMixer)->drive(value[0], value[1], value[2], value[3]);
+    }
+    template <class Mixer>
+    static void callMaxOutput(void *driveMixer, float maxOutput) {
+        ((Mixer *) driveMixer)->setMaxOutput(maxOutput);
+    }
+    // Whether a command at priority replaces whatever is pending
+    static bool request(Counts &counts, bool &pending, Priority &pendingPriority, Priority priority) {
+        if (pending) {
+            counts.overridden++;
+            if (priority < pendingPriority)
+                return false;
+        }
+        pending = true;
+        pendingPriority = priority;
+        return true;
+    }
+
+    double keepalive;
+    SolenoidOutput solenoids[kMaxSolenoids];
+    int numSolenoids;
+    RelayOutput relays[kMaxRelays];
+    int numRelays;
+
+    void *mixer;
+    void (*mix)(void *mixer, const float *value);
+    void (*limit)(void *mixer, float maxOutput);
+    ReentrantSemaphore driveLock;   // the mixer, against a DriveSource's thread
+    Counts driveCounts;
+    Counts sourceCounts;
+    bool drivePending;
+    Priority drivePriority;
+    float driveValue[4];            // x, y, rotation, gyro angle
+    bool driveKnown;
+    float driveApplied[4];
+    Priority appliedPriority;
+    double lastDriveWrite;
+    float driveLimit;
+    bool limitKnown;
+    float appliedLimit;
+};
+
+#endif
@@ -0,0 +1,231 @@
+#ifndef POSE_ESTIMATOR_H
+#define POSE_ESTIMATOR_H
+
+#include "WPILib.h"
+#include "MemoryBarrier.h"
+#include "RateExecutor.h"
+#include "GyroService.h"
+#include <math.h>
+
+/* Where the robot is on the field, in meters with x across the field and y
+ * along it, and its heading in degrees clockwise from +y. Velocities are
+ * field relative. time is the FPGA timestamp of the readings it came from.
+ */
+struct RobotPose {
+    double time;
+    float x, y;
+    float heading;
+    float vx, vy;               // m/s
+    float turnRate;             // deg/s
+};
+
+/* Dead reckoning for a mecanum drive from its four wheel encoders and the
+ * gyro, run from its own Notifier (200 Hz by default) so the integration
+ * step doesn't depend on when packets arrive.
+ *
+ * Each step turns the wheel travel since the last one into forward and
+ * strafe motion with the mecanum forward kinematics (strafing is scaled by
+ * strafeEfficiency, for roller slip) and rotates it onto the field with the
+ * gyro heading halfway through the step. The wheels are left out of the
+ * heading: the gyro is better at it.
+ *
+ * latest() hands out the newest pose without a lock, and poseAt() looks a
+ * pose up from the last kHistorySize steps (about 0.6 s), interpolated, for
+ * measurements that arrive late like a camera frame. Neither waits for the
+ * estimator thread. The pose is never reset by a mode change; setPose()
+ * puts the robot somewhere on purpose. Turns come from the gyro's total
+ * angle, which zeroHeading() leaves alone.
+ *
+ * Encoders are given in RobotDrive's order and must count positive when
+ * their wheel rolls forward.
+ */
+class PoseEstimator {
+public:
+    static const int kHistorySize = 128;
+
+    PoseEstimator(Encoder *frontLeft, Encoder *rearLeft, Encoder *frontRight, Encoder *rearRight,
+                  GyroService *headingGyro, double updatePeriod = 0.005) {
+        encoders[0] = frontLeft;
+        encoders[1] = rearLeft;
+        encoders[2] = frontRight;
+        encoders[3] = rearRight;
+        gyro = headingGyro;
+        period = updatePeriod;
+        strafeEfficiency = 0.8;
+        notifier = new Notifier(PoseEstimator::update, this);
+        pose.time = 0.0;
+        pose.x = 0.0;
+        pose.y = 0.0;
+        pose.heading = 0.0;
+        pose.vx = 0.0;
+        pose.vy = 0.0;
+        pose.turnRate = 0.0;
+        primed = false;
+        steps = 0;
+        published = 0;
+        running = false;
+    }
+    virtual ~PoseEstimator() {
+        stop();
+        delete notifier;
+    }
+    // Fraction of the wheel speed a strafe gets, measured on the carpet;
+    // the rollers lose about a fifth
+    void setStrafeEfficiency(float efficiency) {
+        Synchronized sync(lock);
+        strafeEfficiency = efficiency;
+    }
+    void start() {
+        {
+            Synchronized sync(lock);
+            if (running)
+                return;
+            running = true;
+            primed = false;
+        }
+        notifier->StartPeriodic(period);
+    }
+    void stop() {
+        {
+            Synchronized sync(lock);
+            if (!running)
+                return;
+            running = false;
+        }
+        notifier->Stop();
+    }
+    // Puts the robot at a known spot, e.g. its starting position
+    void setPose(float x, float y, float heading) {
+        Synchronized sync(lock);
+        pose.x = x;
+        pose.y = y;
+        pose.heading = heading;
+        publish();
+    }
+    // False until the first step
+    bool latest(RobotPose &out) {
+        return current.read(out);
+    }
+    // The pose at a past time, interpolated between steps. Anything newer
+    // than the last step gets the last step; false if the time is older
+    // than the history.
+    bool poseAt(double time, RobotPose &out) {
+        UINT32 newest = published;
+        if (newest == 0)
+            return false;
+        RobotPose after;
+        if (!history[(newest - 1) % kHistorySize].read(after))
+            return false;
+        if (time >= after.time) {
+            out = after;
+            return true;
+        }
+        // the oldest slot may be being written over; leave it out
+        UINT32 available = newest < (UINT32) kHistorySize - 1 ? newest : (UINT32) kHistorySize - 1;
+        for (UINT32 n = 1; n < available; n++) {
+            RobotPose before;
+            // a slot newer than the one after it was written over meanwhile
+            if (!history[(newest - 1 - n) % kHistorySize].read(before) || before.time > after.time)
+                return false;
+            if (before.time <= time) {
+                interpolate(before, after, time, out);
+                return true;
+            }
+            after = before;
+        }
+        return false;
+    }
+    long stepCount() {
+        return steps;
+    }
+private:
+    static void update(void *param) {
+        ((PoseEstimator *) param)->step();
+    }
+    void step() {
+        Synchronized sync(lock);
+        if (!running)
+            return;
+        double now = Timer::GetFPGATimestamp();
+        double wheels[4];
+        for (int i = 0; i < 4; i++)
+            wheels[i] = encoders[i]->GetDistance();
+        double angle = gyro->totalAngle();
+        if (!primed) {
+            for (int i = 0; i < 4; i++)
+                lastWheels[i] = wheels[i];
+            lastAngle = angle;
+            lastTime = now;
+            primed = true;
+            pose.time = now;
+            publish();
+            return;
+        }
+        double dt = now - lastTime;
+        double frontLeft = wheels[0] - lastWheels[0];
+        double rearLeft = wheels[1] - lastWheels[1];
+        double frontRight = wheels[2] - lastWheels[2];
+        double rearRight = wheels[3] - lastWheels[3];
+        double forward = (frontLeft + rearLeft + frontRight + rearRight) / 4.0;
+        double strafe = (frontLeft - rearLeft - frontRight + rearRight) / 4.0 * strafeEfficiency;
+        double turn = angle - lastAngle;
+
+        double middle = (pose.heading + turn / 2.0) * (3.14159265358979 / 180.0);
+        double dx = strafe * cos(middle) + forward * sin(middle);
+        double dy = -strafe * sin(middle) + forward * cos(middle);
+        pose.x += (float) dx;
+        pose.y += (float) dy;
+        pose.heading += (float) turn;
+        if (dt > 0.0) {
+            pose.vx = (float) (dx / dt);
+            pose.vy = (float) (dy / dt);
+            pose.turnRate = (float) (turn / dt);
+        }
+        pose.time = now;
+
+        for (int i = 0; i < 4; i++)
+            lastWheels[i] = wheels[i];
+        lastAngle = angle;
+        lastTime = now;
+        steps++;
+        publish();
+    }
+    void publish() {
+        current.publish(pose);
+        history[published % kHistorySize].publish(pose);
+        MEMORY_BARRIER();           // the slot is in place before it is counted
+        published = published + 1;
+    }
+    static void interpolate(const RobotPose &before, const RobotPose &after, double time, RobotPose &out) {
+        double span = after.time - before.time;
+        float fraction = span > 0.0 ? (float) ((time - before.time) / span) : 1.0f;
+        out.time = time;
+        out.x = before.x + (after.x - before.x) * fraction;
+        out.y = before.y + (after.y - before.y) * fraction;
+        out.heading = before.heading + (after.heading - before.heading) * fraction;
+        out.vx = before.vx + (after.vx - before.vx) * fraction;
+        out.vy = before.vy + (after.vy - before.vy) * fraction;
+        out.turnRate = before.turnRate + (after.turnRate - before.turnRate) * fraction;
+    }
+
+    Encoder *encoders[4];
+    GyroService *gyro;
+    Notifier *notifier;
+    ReentrantSemaphore lock;    // the estimator thread against setPose()
+    double period;
+    float strafeEfficiency;
+    bool running;
+
+    RobotPose pose;
+    bool primed;
+    double lastWheels[4];
+    double lastAngle;
+    double lastTime;
+    long steps;
+
+    SnapshotMailbox<RobotPose> current;
+    SnapshotMailbox<RobotPose> history[kHistorySize];
+    volatile UINT32 published;  // poses ever published; written only under lock
+};
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include "WPILib.h"
+#include <math.h>
+#include <stdio.h>
+
+/* Keeps the battery above a floor voltage under load by limiting the drive
+ * and holding off the compressor. A brownout loses the robot for far longer
+ * than giving up some drive output does.
+ *
+ * update() is called once per cycle with the battery voltage. The current
+ * draw is estimated from what each subsystem was told to do: every drive
+ * motor in proportion to its output, the compressor while it runs, and a
+ * fixed amount for the electronics. Each cycle's estimated current and
+ * measured voltage go into an exponentially weighted least-squares line,
+ * which gives the battery's open-circuit voltage and internal resistance and
+ * follows them as the battery runs down.
+ *
+ * driveLimit() is the largest fraction of the requested drive output that
+ * keeps the predicted voltage above the floor. It is meant for the drive
+ * mixer's setMaxOutput(), which scales every wheel alike, so the mix of
+ * x, y and rotation is kept. The limit drops at once and recovers at
+ * recoveryRate per second. compressorHeld() asks for the compressor to be
+ * stopped while running it with the present drive demand would take the
+ * battery below the floor plus a margin; a hold lasts at most maxHold, and
+ * the compressor then runs for at least minRun before it can be held again.
+ *
+ * dump() reports how much of the requested drive output was given up and
+ * how long the compressor was held.
+ */
+class PowerManager {
+public:
+    static const int kMaxMotors = 4;
+
+    explicit PowerManager(float floorVoltage = 7.5) {
+        floor = floorVoltage;
+        baseCurrent = 3.0;
+        motorCurrent = 40.0;
+        compressorCurrent = 15.0;
+        compressorMargin = 0.5;
+        hysteresis = 0.3;
+        maxHold = 5.0;
+        minRun = 2.0;
+        recoveryRate = 2.0;
+        minLimit = 0.3;
+        fitTime = 5.0;
+        minSpread = 10.0;
+        numMotors = 0;
+        openVoltage = 12.5;
+        resistance = 0.03;
+        samples = 0;
+        reset();
+        clearStats();
+    }
+    void addDriveMotor(SpeedController *motor) {
+        if (numMotors < kMaxMotors)
+            motors[numMotors++] = motor;
+    }
+    // The battery is kept above volts
+    void setFloor(float volts) {
+        floor = volts;
+    }
+    // Amps drawn by the electronics, by a drive motor at full output and by
+    // the compressor
+    void setCurrents(double base, double motor, double compressor) {
+        baseCurrent = base;
+        motorCurrent = motor;
+        compressorCurrent = compressor;
+    }
+    // Volts above the floor the compressor needs to be let run, and the
+    // longest hold (s) and shortest run between holds (s)
+    void setCompressorHold(double margin, double longestHold, double shortestRun) {
+        compressorMargin = margin;
+        maxHold = longestHold;
+        minRun = shortestRun;
+    }
+    // How fast the drive limit comes back up, per second
+    void setRecoveryRate(double rate) {
+        recoveryRate = rate;
+    }
+    // For a mode change: no limit and no hold. What was learned about the
+    // battery is kept.
+    void reset() {
+        limit = 1.0;
+        held = false;
+        heldSince = 0.0;
+        releasedAt = -1e9;
+        lastTime = -1.0;
+    }
+    void clearStats() {
+        cycles = 0;
+        limitedCycles = 0;
+        limitedTime = 0.0;
+        requested = 0.0;
+        givenUp = 0.0;
+        lowestLimit = 1.0;
+        lowestVoltage = 99.0;
+        belowFloor = 0.0;
+        holds = 0;
+        heldTime = 0.0;
+    }
+    // compressorOn is whether the compressor is started; pressureSwitch is
+    // true once the tank is full
+    void update(double now, float batteryVoltage, bool compressorOn, bool pressureSwitch) {
+        double dt = lastTime < 0.0 ? 0.0 : now - lastTime;
+        lastTime = now;
+
+        // what the motors were doing when the voltage was read
+        double output = 0.0;
+        for (int i = 0; i < numMotors; i++)
+            output += fabs(motors[i]->Get());
+        bool running = compressorOn && !pressureSwitch;
+        fit(baseCurrent + motorCurrent * output + (running ? compressorCurrent : 0.0), batteryVoltage, dt);
+
+        // the drive output asked for, before the limit
+        double demand = output / limit;
+        if (demand > numMotors)
+            demand = numMotors;
+        double driveCurrent = motorCurrent * demand;
+
+        bool wanted = !pressureSwitch;
+        double withCompressor = predict(baseCurrent + compressorCurrent + driveCurrent);
+        if (held) {
+            if (!wanted || withCompressor > floor + compressorMargin + hysteresis
+                || now - heldSince >= maxHold) {
+                held = false;
+                releasedAt = now;
+            }
+        }
+        else if (wanted && withCompressor < floor + compressorMargin && now - releasedAt >= minRun) {
+            held = true;
+            heldSince = now;
+            holds++;
+        }
+
+        double fixed = baseCurrent + (wanted && !held ? compressorCurrent : 0.0);
+        double target = 1.0;
+        double available = (openVoltage - floor) / resistance - fixed;
+        if (driveCurrent > 0.0 && available < driveCurrent)
+            target = available / driveCurrent;
+        if (target < minLimit)
+            target = minLimit;
+        if (target < limit)
+            limit = target;
+        else
+            limit = limit + recoveryRate * dt < target ? limit + recoveryRate * dt : target;
+
+        cycles++;
+        requested += demand * dt;
+        givenUp += demand * (1.0 - limit) * dt;
+        if (limit < 1.0) {
+            limitedCycles++;
+            limitedTime += dt;
+        }
+        if (limit < lowestLimit)
+            lowestLimit = limit;
+        if (batteryVoltage < lowestVoltage)
+            lowestVoltage = batteryVoltage;
+        // riding on the floor is what the limit is for; only count real dips
+        if (batteryVoltage < floor - 0.05)
+            belowFloor += dt;
+        if (held)
+            heldTime += dt;
+    }
+    // Fraction of the requested drive output to use, for SetMaxOutput()
+    float driveLimit() {
+        return (float) limit;
+    }
+    bool compressorHeld() {
+        return held;
+    }
+    double openCircuitVoltage() {
+        return openVoltage;
+    }
+    double internalResistance() {
+        return resistance;
+    }
+    void dump(FILE *out = stdout) {
+        fprintf(out, "power: floor %.2f V; battery %.2f V open circuit, %.3f ohm\n",
+                floor, openVoltage, resistance);
+        if (cycles == 0)
+            return;
+        fprintf(out, "  lowest %.2f V, %.2f s below the floor\n", lowestVoltage, belowFloor);
+        fprintf(out, "  drive limited %.2f s (%ld of %ld cycles, lowest %.2f), %.1f%% of the output asked for given up\n",
+                limitedTime, limitedCycles, cycles, lowestLimit,
+                requested > 0.0 ? 100.0 * givenUp / requested : 0.0);
+        fprintf(out, "  compressor held %ld times, %.2f s\n", holds, heldTime);
+    }
+private:
+    double predict(double current) {
+        return openVoltage - resistance * current;
+    }
+    // Weighted means of current and voltage, forgetting over fitTime. The
+    // resistance only moves once the current has varied enough to measure
+    // it by.
+    void fit(double current, double volts, double dt) {
+        if (samples == 0) {
+            meanI = current;
+            meanV = volts;
+            meanII = current * current;
+            meanIV = current * volts;
+        }
+        else {
+            double alpha = dt / fitTime;
+            if (alpha > 1.0)
+                alpha = 1.0;
+            meanI += alpha * (current - meanI);
+            meanV += alpha * (volts - meanV);
+            meanII += alpha * (current * current - meanII);
+            meanIV += alpha * (current * volts - meanIV);
+        }
+        samples++;
+        double spread = meanII - meanI * meanI;
+        if (spread > minSpread * minSpread) {
+            double fitted = -(meanIV - meanI * meanV) / spread;
+            if (fitted > 0.005 && fitted < 0.2)
+                resistance = fitted;
+        }
+        openVoltage = meanV + resistance * meanI;
+    }
+
+    double floor;
+    double baseCurrent;
+    double motorCurrent;
+    double compressorCurrent;
+    double compressorMargin;
+    double hysteresis;
+    double maxHold;
+    double minRun;
+    double recoveryRate;
+    double minLimit;
+    double fitTime;             // s the battery fit remembers
+    double minSpread;           // A of current variation before fitting the resistance
+
+    SpeedController *motors[kMaxMotors];
+    int numMotors;
+
+    double openVoltage;
+    double resistance;
+    long samples;
+    double meanI, meanV, meanII, meanIV;
+
+    double limit;
+    bool held;
+    double heldSince;
+    double releasedAt;
+    double lastTime;
+
+    long cycles;
+    long limitedCycles;
+    double limitedTime;
+    double requested;           // drive output asked for, integrated over time
+    double givenUp;             // the part of it the limit took away
+    double lowestLimit;
+    float lowestVoltage;
+    double belowFloor;
+    long holds;
+    double heldTime;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef PRESSURE_ESTIMATOR_H
+#define PRESSURE_ESTIMATOR_H
+
+#include "WPILib.h"
+#include <math.h>
+
+/* Estimates the storage tank and launcher cylinder pressures (psi gauge) so
+ * the launcher can be called ready as soon as it can make a full-power
+ * shot, instead of after a fixed delay.
+ *
+ * The tank fills while the compressor runs, a little slower the fuller it
+ * is. Charging the launcher (launch solenoid retracted) fills the cylinder
+ * from the regulator with a first-order lag and takes that air out of the
+ * tank; dropping the launcher vents the cylinder. Every lock or blocker
+ * actuation costs the tank a fixed amount.
+ *
+ * The pressure switch is the only real measurement. It closes at
+ * switchPressure and opens again at switchLowPressure, so each edge pins
+ * the tank estimate. When it closes, the difference between the estimate
+ * and switchPressure also trims the compressor fill rate, which calibrates
+ * the model to this robot's compressor and tank over a match.
+ */
+class PressureEstimator {
+public:
+    PressureEstimator() {
+        fillRate = 2.0;
+        stallPressure = 150.0;
+        switchPressure = 120.0;
+        switchLowPressure = 95.0;
+        regulatedPressure = 60.0;
+        cylinderTimeConstant = 0.8;
+        cylinderShare = 0.25;
+        valveCost = 1.0;
+        shotPressure = 55.0;
+        margin = 2.0;
+        calibrationGain = 0.5;
+        fillScale = 1.0;
+        tank = 0.0;
+        cylinder = 0.0;
+        lastTime = -1.0;
+        wasFull = false;
+        runStart = 0.0;
+        calibrations = 0;
+        lastLaunch = lastLock = lastBlocker = DoubleSolenoid::kOff;
+    }
+    // Pressure a full-power shot needs, and how far above it to call the
+    // launcher ready
+    void setShotPressure(double pressure, double safetyMargin) {
+        shotPressure = pressure;
+        margin = safetyMargin;
+    }
+    // Fill rate of an empty tank (psi/s) and how fast the launcher cylinder
+    // charges (time constant, s)
+    void setRates(double tankFillRate, double cylinderCharge) {
+        fillRate = tankFillRate;
+        cylinderTimeConstant = cylinderCharge;
+    }
+    // Moves the model to now from the compressor and solenoid states
+    void update(double now, bool compressorEnabled, bool switchFull, DoubleSolenoid::Value launch,
+                DoubleSolenoid::Value lock, DoubleSolenoid::Value blocker) {
+        double dt = lastTime < 0.0 ? 0.0 : now - lastTime;
+        lastTime = now;
+
+        if (compressorEnabled && !switchFull)
+            tank += fillRate * fillScale * (1.0 - tank / stallPressure) * dt;
+
+        if (launch == DoubleSolenoid::kReverse) {
+            double target = tank < regulatedPressure ? tank : regulatedPressure;
+            double step = (target - cylinder) * (1.0 - exp(-dt / cylinderTimeConstant));
+            if (step > 0.0) {
+                cylinder += step;
+                tank -= step * cylinderShare;
+            }
+        }
+        else if (launch == DoubleSolenoid::kForward) {
+            cylinder = 0.0;
+        }
+        if (lock != lastLock && lock != DoubleSolenoid::kOff)
+            tank -= valveCost;
+        if (blocker != lastBlocker && blocker != DoubleSolenoid::kOff)
+            tank -= valveCost;
+        if (launch != lastLaunch && launch == DoubleSolenoid::kForward)
+            tank -= valveCost;
+        lastLaunch = launch;
+        lastLock = lock;
+        lastBlocker = blocker;
+
+        if (switchFull && !wasFull) {
+            calibrate(now);
+            tank = switchPressure;
+        }
+        else if (!switchFull && wasFull) {
+            tank = switchLowPressure;
+            runStart = now;
+        }
+        // an estimate over switchPressure before the switch closes is left
+        // alone, so the calibration sees how far off the fill rate is
+        if (switchFull && tank < switchLowPressure)
+            tank = switchLowPressure;
+        if (tank < 0.0)
+            tank = 0.0;
+        wasFull = switchFull;
+    }
+    bool ready() {
+        return cylinder >= shotPressure + margin;
+    }
+    double tankPressure() {
+        return tank;
+    }
+    double launcherPressure() {
+        return cylinder;
+    }
+    // Compressor fill rate relative to the configured one, as calibrated
+    double fillCalibration() {
+        return fillScale;
+    }
+    long calibrationCount() {
+        return calibrations;
+    }
+private:
+    // Only a run that started from a known pressure (the switch opening)
+    // says anything about the fill rate
+    void calibrate(double now) {
+        if (runStart <= 0.0 || now - runStart < 1.0)
+            return;
+        double gained = tank - switchLowPressure;
+        double wanted = switchPressure - switchLowPressure;
+        if (gained <= 0.0)
+            gained = 1.0;
+        double ratio = wanted / gained;
+        fillScale *= 1.0 + calibrationGain * (ratio - 1.0);
+        if (fillScale < 0.25)
+            fillScale = 0.25;
+        if (fillScale > 4.0)
+            fillScale = 4.0;
+        calibrations++;
+    }
+
+    double fillRate;
+    double stallPressure;
+    double switchPressure;
+    double switchLowPressure;
+    double regulatedPressure;
+    double cylinderTimeConstant;
+    double cylinderShare;
+    double valveCost;
+    double shotPressure;
+    double margin;
+    double calibrationGain;
+    double fillScale;
+
+    double tank;
+    double cylinder;
+    double lastTime;
+    bool wasFull;
+    double runStart;
+    long calibrations;
+    DoubleSolenoid::Value lastLaunch, lastLock, lastBlocker;
+};
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef RATE_EXECUTOR_H
+#define RATE_EXECUTOR_H
+
+#include "WPILib.h"
+#include "LoopTimer.h"
+#include "MemoryBarrier.h"
+#include <stdio.h>
+
+/* Latest copy of some state, handed from one task to another without a
+ * lock. One task publishes; any number read. A reader that catches the
+ * writer halfway through (the sequence number is odd, or moved while it
+ * copied) tries again a couple of times and otherwise gives up until its
+ * next run, so neither side ever waits for the other. That matters when a
+ * high priority reader preempts a low priority writer: on the cRIO's single
+ * core the writer can't finish until the reader lets go.
+ */
+template <class T>
+class SnapshotMailbox {
+public:
+    static const int kAttempts = 3;
+
+    SnapshotMailbox() {
+        sequence = 0;
+    }
+    void publish(const T &value) {
+        sequence = sequence + 1;
+        MEMORY_BARRIER();
+        data = value;
+        MEMORY_BARRIER();
+        sequence = sequence + 1;
+    }
+    // False if nothing has been published yet or no clean copy could be had
+    bool read(T &out) {
+        for (int i = 0; i < kAttempts; i++) {
+            UINT32 before = sequence;
+            if (before == 0)
+                return false;
+            if (before & 1)
+                continue;
+            MEMORY_BARRIER();
+            out = data;
+            MEMORY_BARRIER();
+            if (sequence == before)
+                return true;
+        }
+        return false;
+    }
+    // Like read(), but only when something newer than seen was published
+    bool readIfNew(T &out, UINT32 &seen) {
+        UINT32 current = sequence;
+        if (current == seen)
+            return false;
+        if (!read(out))
+            return false;
+        seen = current;
+        return true;
+    }
+private:
+    T data;
+    volatile UINT32 sequence;
+};
+
+/* Runs the robot's work at independent rates instead of all of it on every
+ * driver station packet.
+ *
+ * Each task has a period and a vxWorks priority (lower numbers run first).
+ * Tasks at the robot task's own priority or better are foreground: tick(),
+ * called from the periodic loop, runs whichever of them are due, most
+ * important first. Only short, urgent work belongs there, since everything
+ * in a tick delays the next one. Every other priority gets its own WPILib
+ * Task that sleeps until its next task is due, so a slow task (LCD text,
+ * NetworkTables) can be preempted by the robot task and never delays it.
+ *
+ * A task is due once it is within a quarter period of its release time, so
+ * a 50 Hz task on a 100 Hz loop isn't skipped when a tick comes in a little
+ * early. Releases that pass by while a task is still waiting to run are
+ * counted as missed, not made up. Each task has its own duration histogram,
+ * run count, overruns (ran longer than its period) and missed releases.
+ */
+class RateExecutor {
+public:
+    static const int kMaxTasks = 12;
+    static const int kMaxGroups = 4;
+
+    explicit RateExecutor(INT32 robotPriority = Task::kDefaultPriority) {
+        foregroundPriority = robotPriority;
+        numTasks = 0;
+        numGroups = 1;          // group 0 is the foreground
+        groups[0].priority = robotPriority;
+        groups[0].task = 0;
+        running = false;
+    }
+    // Stops the background tasks, waiting for each to finish its current run
+    virtual ~RateExecutor() {
+        running = false;
+        for (int i = 1; i < numGroups; i++) {
+            if (!groups[i].task)
+                continue;
+            while (!groups[i].finished)
+                Wait(0.01);
+            delete groups[i].task;
+        }
+        for (int i = 0; i < numTasks; i++)
+            delete tasks[i].runner;
+    }
+    // Adds owner->method() at period seconds. Names must stay put (string
+    // literals). Add every task before start().
+    template <class T>
+    bool addTask(const char *name, double period, INT32 priority, T *owner, void (T::*method)()) {
+        if (numTasks >= kMaxTasks || running)
+            return false;
+        int group = groupFor(priority);
+        if (group < 0)
+            return false;
+        // keep the table in priority order so a tick runs the urgent ones first
+        int slot = numTasks;
+        while (slot > 0 && tasks[slot - 1].priority > priority) {
+            tasks[slot] = tasks[slot - 1];
+            slot--;
+        }
+        RateTask &task = tasks[slot];
+        task.name = name;
+        task.period = period;
+        task.priority = priority;
+        task.group = group;
+        task.runner = new MemberRunner<T>(owner, method);
+        task.next = 0.0;
+        task.runs = 0;
+        task.overruns = 0;
+        task.missed = 0;
+        task.histogram.reset();
+        numTasks++;
+        return true;
+    }
+    // Starts a WPILib Task for each background priority
+    void start() {
+        if (running)
+            return;
+        running = true;
+        for (int i = 1; i < numGroups; i++) {
+            groups[i].finished = false;
+            groups[i].task = new Task(groups[i].name, (FUNCPTR) RateExecutor::groupTask, groups[i].priority);
+            groups[i].task->Start((size_t) this, (size_t) i);
+        }
+    }
+    // Runs the foreground tasks that are due; called once per periodic call
+    void tick() {
+        runDue(0, Timer::GetFPGATimestamp());
+    }
+    // Foreground tasks start again from the next tick, e.g. after a mode
+    // change, instead of counting the time in between as missed releases
+    void resync() {
+        for (int i = 0; i < numTasks; i++)
+            if (tasks[i].group == 0)
+                tasks[i].next = 0.0;
+    }
+    // The background counters are read without stopping their tasks, so a
+    // line can be a run behind
+    void dump(FILE *out = stdout) {
+        fprintf(out, "%-22s %5s %8s %9s %9s %9s %8s %8s\n", "rate tasks", "Hz", "runs",
+                "mean ms", "p99 ms", "max ms", "overrun", "missed");
+        for (int i = 0; i < numTasks; i++) {
+            RateTask &task = tasks[i];
+            fprintf(out, "%-22s %5.0f %8ld %9.3f %9.3f %9.3f %8ld %8ld\n", task.name,
+                    1.0 / task.period, task.runs, task.histogram.mean() / 1000.0,
+                    task.histogram.percentile(0.99) / 1000.0, task.histogram.max() / 1000.0,
+                    task.overruns, task.missed);
+        }
+    }
+private:
+    struct Runner {
+        virtual ~Runner() {}
+        virtual void run() = 0;
+    };
+    template <class T>
+    struct MemberRunner : public Runner {
+        MemberRunner(T *owner, void (T::*method)()) : owner(owner), method(method) {}
+        virtual void run() {
+            (owner->*method)();
+        }
+        T *owner;
+        void (T::*method)();
+    };
+    struct RateTask {
+        const char *name;
+        double period;
+        INT32 priority;
+        int group;
+        Runner *runner;
+        double next;            // release time; 0 until the first run
+        long runs;
+        long overruns;
+        long missed;
+        LatencyHistogram histogram;
+    };
+    struct Group {
+        INT32 priority;
+        char name[24];
+        Task *task;
+        volatile bool finished;
+    };
+
+    int groupFor(INT32 priority) {
+        if (priority <= foregroundPriority)
+            return 0;
+        for (int i = 1; i < numGroups; i++)
+            if (groups[i].priority == priority)
+                return i;
+        if (numGroups >= kMaxGroups)
+            return -1;
+        Group &group = groups[numGroups];
+        group.priority = priority;
+        sprintf(group.name, "RateGroup%ld", (long) priority);
+        group.task = 0;
+        group.finished = true;
+        return numGroups++;
+    }
+    // Runs the group's due tasks; returns when the next one is due
+    double runDue(int group, double now) {
+        double earliest = now + 1.0;
+        for (int i = 0; i < numTasks; i++) {
+            RateTask &task = tasks[i];
+            if (task.group != group)
+                continue;
+            if (task.next == 0.0)
+                task.next = now;
+            if (now + task.period / 4.0 >= task.next) {
+                UINT32 started = GetFPGATime();
+                task.runner->run();
+                UINT32 elapsed = GetFPGATime() - started;
+                task.histogram.record(elapsed);
+                task.runs++;
+                if (elapsed > task.period * 1e6)
+                    task.overruns++;
+                task.next += task.period;
+                while (task.next <= now) {
+                    task.next += task.period;
+                    task.missed++;
+                }
+            }
+            if (task.next < earliest)
+                earliest = task.next;
+        }
+        return earliest;
+    }
+    static int groupTask(RateExecutor *executor, int group) {
+        while (executor->running) {
+            double next = executor->runDue(group, Timer::GetFPGATimestamp());
+            double wait = next - Timer::GetFPGATimestamp();
+            if (wait > 0.0)
+                Wait(wait);
+        }
+        executor->groups[group].finished = true;
+        return 0;
+    }
+
+    INT32 foregroundPriority;
+    RateTask tasks[kMaxTasks];
+    int numTasks;
+    Group groups[kMaxGroups];
+    int numGroups;
+    volatile bool running;
+};
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef ROBOT_CORE_H
+#define ROBOT_CORE_H
+
+#include "WPILib.h"
+#include "BufferedLCD.h"
+#include "GyroService.h"
+#include "HeadingController.h"
+#include "PoseEstimator.h"
+#include <math.h>
+
+// Where the gyro's bias and scale are kept between boots
+#ifndef GYRO_CALIBRATION
+#define GYRO_CALIBRATION "/gyro.cal"
+#endif
+
+// The cRIO's compiler has no static_assert; a negative array size stops the
+// build instead
+#define CORE_STATIC_ASSERT(condition, name) typedef char name[(condition) ? 1 : -1]
+
+enum DriveType {TANK_DRIVE, MECANUM_DRIVE};
+
+// Xbox controller buttons and axes, as the driver station numbers them
+enum XboxButton {XBOX_A = 1, XBOX_B = 2, XBOX_X = 3, XBOX_Y = 4, XBOX_LEFT_BUMPER = 5,
+                 XBOX_RIGHT_BUMPER = 6, XBOX_BACK = 7, XBOX_START = 8,
+                 XBOX_LEFT_ANALOG_PRESS = 9, XBOX_RIGHT_ANALOG_PRESS = 10};
+enum XboxAxis {XBOX_LEFT_X = 1, XBOX_LEFT_Y = 2, XBOX_TRIGGERS = 3, XBOX_RIGHT_X = 4,
+               XBOX_RIGHT_Y = 5, XBOX_DPAD_X = 6};
+
+/* The four drive Talons with the motor safety and output limit a
+ * RobotDrive would give them. Which motors run backwards comes from the
+ * Config as compile-time signs, so writing a wheel is a multiply by a
+ * constant and a direct (not virtual) Talon::Set().
+ */
+template <class Config>
+class DriveMotors {
+public:
+    static const int kFrontLeftSign  = Config::kInvertFrontLeft ? -1 : 1;
+    static const int kRearLeftSign   = Config::kInvertRearLeft ? -1 : 1;
+    static const int kFrontRightSign = Config::kInvertFrontRight ? -1 : 1;
+    static const int kRearRightSign  = Config::kInvertRearRight ? -1 : 1;
+
+    DriveMotors(Talon *frontLeftMotor, Talon *rearLeftMotor, Talon *frontRightMotor,
+                Talon *rearRightMotor) {
+        frontLeft = frontLeftMotor;
+        rearLeft = rearLeftMotor;
+        frontRight = frontRightMotor;
+        rearRight = rearRightMotor;
+        maxOutput = 1.0;
+        Talon *motors[] = {frontLeft, rearLeft, frontRight, rearRight};
+        for (int i = 0; i < 4; i++) {
+            motors[i]->SetExpiration(0.1);
+            motors[i]->SetSafetyEnabled(true);
+        }
+    }
+    // Fraction of every output to use, like RobotDrive::SetMaxOutput()
+    void setMaxOutput(double limit) {
+        maxOutput = limit;
+    }
+    void stopMotor() {
+        frontLeft->Talon::Disable();
+        rearLeft->Talon::Disable();
+        frontRight->Talon::Disable();
+        rearRight->Talon::Disable();
+    }
+protected:
+    // Each wheel's output before the inversion and the limit
+    void setWheels(double frontLeftOutput, double rearLeftOutput, double frontRightOutput,
+                   double rearRightOutput) {
+        frontLeft->Talon::Set(frontLeftOutput * kFrontLeftSign * maxOutput);
+        rearLeft->Talon::Set(rearLeftOutput * kRearLeftSign * maxOutput);
+        frontRight->Talon::Set(frontRightOutput * kFrontRightSign * maxOutput);
+        rearRight->Talon::Set(rearRightOutput * kRearRightSign * maxOutput);
+    }
+    // Scales the outputs down together so none is over 1
+    static void normalize(double *outputs, int count) {
+        double biggest = 0.0;
+        for (int i = 0; i < count; i++)
+            if (fabs(outputs[i]) > biggest)
+                biggest = fabs(outputs[i]);
+        if (biggest > 1.0)
+            for (int i = 0; i < count; i++)
+                outputs[i] /= biggest;
+    }
+
+    Talon *frontLeft;
+    Talon *rearLeft;
+    Talon *frontRight;
+    Talon *rearRight;
+    double maxOutput;
+};
+
+/* Turns (x, y, rotation) into the four wheel outputs for the drive type
+ * the Config names; the choice is made when the robot is compiled. y is
+ * forward (negative, like a joystick pushed forward), x is strafe and
+ * rotation is clockwise.
+ */
+template <class Config, DriveType type = Config::kDriveType>
+class DriveMixer;
+
+template <class Config>
+class DriveMixer<Config, MECANUM_DRIVE> : public DriveMotors<Config> {
+public:
+    DriveMixer(Talon *frontLeftMotor, Talon *rearLeftMotor, Talon *frontRightMotor, Talon *rearRightMotor)
+        : DriveMotors<Config>(frontLeftMotor, rearLeftMotor, frontRightMotor, rearRightMotor) {}
+    // The mix of RobotDrive::MecanumDrive_Cartesian(); with a gyro angle,
+    // x and y are field relative
+    void drive(float x, float y, float rotation, float gyroAngle) {
+        double cosA = cos(gyroAngle * (3.14159 / 180.0));
+        double sinA = sin(gyroAngle * (3.14159 / 180.0));
+        double xIn = x * cosA + y * sinA;
+        double yIn = x * sinA - y * cosA;
+        double wheels[4] = {xIn + yIn + rotation, -xIn + yIn + rotation,
+                            -xIn + yIn - rotation, xIn + yIn - rotation};
+        this->normalize(wheels, 4);
+        this->setWheels(wheels[0], wheels[1], wheels[2], wheels[3]);
+    }
+};
+
+template <class Config>
+class DriveMixer<Config, TANK_DRIVE> : public DriveMotors<Config> {
+public:
+    DriveMixer(Talon *frontLeftMotor, Talon *rearLeftMotor, Talon *frontRightMotor, Talon *rearRightMotor)
+        : DriveMotors<Config>(frontLeftMotor, rearLeftMotor, frontRightMotor, rearRightMotor) {}
+    // The mecanum mix without the strafe, so both wheels on a side agree; a
+    // tank drive can't strafe or drive field relative, so x and the gyro
+    // angle are ignored
+    void drive(float x, float y, float rotation, float gyroAngle) {
+        double sides[2] = {-y + rotation, -y - rotation};
+        this->normalize(sides, 2);
+        this->setWheels(sides[0], sides[0], sides[1], sides[1]);
+    }
+};
+
+/* What every robot of ours has: four drive Talons, an Xbox
+ * controller, optionally a gyro with a heading controller and wheel
+ * encoders with a pose estimator, and the LCD.
+ *
+ * Config is a struct of compile-time constants:
+ *
+ *   kDriveType                    TANK_DRIVE or MECANUM_DRIVE
+ *   kFrontLeftWheel ...           PWM channel of each Talon
+ *   kInvertFrontLeft ...          whether that motor runs backwards
+ *   kControllerPort               driver station port of the Xbox controller
+ *   kHasGyro, kGyroChannel        gyro (and heading controller) or none;
+ *                                 calibrated from GYRO_CALIBRATION
+ *   kHasEncoders                  an encoder on each wheel; with the gyro,
+ *                                 a pose estimator runs from construction
+ *   kFrontLeftEncoderA/B ...      digital channels of each encoder
+ *   kEncoderPulses                pulses per wheel turn
+ *   kWheelDiameterMm              wheel diameter
+ *
+ * Mistakes like two wheels on one channel stop the build. driveMixer, a
+ * DriveMixer<Config>, writes the Talons with the drive type's mix and the
+ * inversions fixed at compile time; everything that moves the robot goes
+ * through it, driveRobot() directly and the 2014 robot's OutputStage by
+ * way of setDrive(). The heading controller drives the mixer from its own
+ * thread unless the robot gives it another output. What is left to run time is the gyro,
+ * the encoders and the heading controller, which exist or not by the
+ * Config's constants but are reached through pointers that are 0 when
+ * they don't. The robot class derives from RobotCore<ItsConfig> and adds
+ * its own mechanisms.
+ */
+template <class Config>
+class RobotCore : public IterativeRobot {
+    CORE_STATIC_ASSERT(Config::kFrontLeftWheel >= 1 && Config::kFrontLeftWheel <= 10 &&
+                       Config::kRearLeftWheel >= 1 && Config::kRearLeftWheel <= 10 &&
+                       Config::kFrontRightWheel >= 1 && Config::kFrontRightWheel <= 10 &&
+                       Config::kRearRightWheel >= 1 && Config::kRearRightWheel <= 10,
+                       wheelOnPWMChannel);
+    CORE_STATIC_ASSERT(Config::kFrontLeftWheel != Config::kRearLeftWheel &&
+                       Config::kFrontLeftWheel != Config::kFrontRightWheel &&
+                       Config::kFrontLeftWheel != Config::kRearRightWheel &&
+                       Config::kRearLeftWheel != Config::kFrontRightWheel &&
+                       Config::kRearLeftWheel != Config::kRearRightWheel &&
+                       Config::kFrontRightWheel != Config::kRearRightWheel,
+                       wheelsOnDistinctChannels);
+    CORE_STATIC_ASSERT(Config::kControllerPort >= 1 && Config::kControllerPort <= 4,
+                       controllerOnDriverStationPort);
+    CORE_STATIC_ASSERT(!Config::kHasEncoders ||
+                       (Config::kFrontLeftEncoderA >= 1 && Config::kFrontLeftEncoderA <= 14 &&
+                        Config::kFrontLeftEncoderB >= 1 && Config::kFrontLeftEncoderB <= 14 &&
+                        Config::kRearLeftEncoderA >= 1 && Config::kRearLeftEncoderA <= 14 &&
+                        Config::kRearLeftEncoderB >= 1 && Config::kRearLeftEncoderB <= 14 &&
+                        Config::kFrontRightEncoderA >= 1 && Config::kFrontRightEncoderA <= 14 &&
+                        Config::kFrontRightEncoderB >= 1 && Config::kFrontRightEncoderB <= 14 &&
+                        Config::kRearRightEncoderA >= 1 && Config::kRearRightEncoderA <= 14 &&
+                        Config::kRearRightEncoderB >= 1 && Config::kRearRightEncoderB <= 14 &&
+                        Config::kEncoderPulses > 0 && Config::kWheelDiameterMm > 0),
+                       encodersOnDigitalChannels);
+public:
+    typedef DriveMixer<Config> Mixer;
+
+    RobotCore() {
+        frontLeftWheel  = new Talon(Config::kFrontLeftWheel);
+        rearLeftWheel   = new Talon(Config::kRearLeftWheel);
+        frontRightWheel = new Talon(Config::kFrontRightWheel);
+        rearRightWheel  = new Talon(Config::kRearRightWheel);
+        driveMixer = new Mixer(frontLeftWheel, rearLeftWheel, frontRightWheel, rearRightWheel);
+
+        controller = new Joystick(Config::kControllerPort);
+
+        gyro = 0;
+        headingController = 0;
+        if (Config::kHasGyro) {
+            gyro = new GyroService(Config::kGyroChannel, GYRO_CALIBRATION);
+            headingController = new HeadingController(gyro);
+            headingController->setOutput(driveMixer);
+        }
+
+        // the encoders turn with their motors, so they are reversed alike
+        frontLeftEncoder = rearLeftEncoder = frontRightEncoder = rearRightEncoder = 0;
+        poseEstimator = 0;
+        if (Config::kHasEncoders) {
+            frontLeftEncoder = newEncoder(Config::kFrontLeftEncoderA, Config::kFrontLeftEncoderB,
+                                          Config::kInvertFrontLeft);
+            rearLeftEncoder = newEncoder(Config::kRearLeftEncoderA, Config::kRearLeftEncoderB,
+                                         Config::kInvertRearLeft);
+            frontRightEncoder = newEncoder(Config::kFrontRightEncoderA, Config::kFrontRightEncoderB,
+                                           Config::kInvertFrontRight);
+            rearRightEncoder = newEncoder(Config::kRearRightEncoderA, Config::kRearRightEncoderB,
+                                          Config::kInvertRearRight);
+        }
+        if (Config::kHasEncoders && Config::kHasGyro) {
+            poseEstimator = new PoseEstimator(frontLeftEncoder, rearLeftEncoder, frontRightEncoder,
+                                              rearRightEncoder, gyro);
+            poseEstimator->start();
+        }
+
+        dsLCD = DriverStationLCD::GetInstance();
+        lcd = new BufferedLCD(dsLCD);
+    }
+    virtual ~RobotCore() {
+        delete poseEstimator;
+    }
+
+    // Straight to the drive; x is ignored by a tank drive
+    void driveRobot(float x, float y, float rotation, float gyroAngle = 0.0) {
+        driveMixer->drive(x, y, rotation, gyroAngle);
+    }
+    void stopRobot() {
+        driveRobot(0.0, 0.0, 0.0);
+    }
+    // The present heading becomes zero; the gyro and the pose estimator's
+    // heading carry on
+    void zeroHeading() {
+        if (gyro)
+            gyro->zeroHeading();
+    }
+    // Buffered; the LCD is only sent by lcd->flush()
+    void printMessage(const char *message, char lineNum) {
+        lcd->setText(lineNum, message);
+    }
+protected:
+    static Encoder *newEncoder(UINT32 aChannel, UINT32 bChannel, bool reverse) {
+        Encoder *encoder = new Encoder(aChannel, bChannel, reverse);
+        encoder->SetDistancePerPulse(3.14159265358979 * Config::kWheelDiameterMm / 1000.0
+                                     / Config::kEncoderPulses);
+        encoder->Start();
+        return encoder;
+    }
+
+    Talon *frontLeftWheel;
+    Talon *rearLeftWheel;
+    Talon *frontRightWheel;
+    Talon *rearRightWheel;
+    Mixer *driveMixer;
+
+    Joystick *controller;
+    GyroService *gyro;                      // 0 without kHasGyro
+    HeadingController *headingController;   // 0 without kHasGyro
+
+    Encoder *frontLeftEncoder;              // 0 without kHasEncoders
+    Encoder *rearLeftEncoder;
+    Encoder *frontRightEncoder;
+    Encoder *rearRightEncoder;
+    PoseEstimator *poseEstimator;           // 0 without both encoders and gyro
+
+    DriverStationLCD *dsLCD;
+    BufferedLCD *lcd;
+};
+
+#endif
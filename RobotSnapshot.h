@@ -0,0 +1,48 @@
+#ifndef ROBOT_SNAPSHOT_H
+#define ROBOT_SNAPSHOT_H
+
+#include "WPILib.h"
+#include "VisionTarget.h"
+
+/* Every input the 2014 robot looks at, read once at the start of a periodic
+ * call. All of the robot logic for that cycle works from this copy, so the
+ * hardware is only read once and every decision in a cycle sees the same
+ * values.
+ *
+ * Axes are indexed by WPILib axis number (1-6); buttons are bit masks with
+ * bit 0 for button 1, like DriverStation::GetStickButtons().
+ */
+struct RobotSnapshot {
+    static const int kNumAxes = 6;
+
+    double time;
+
+    float controllerAxes[kNumAxes + 1];
+    UINT32 controllerButtons;
+    float joystickAxes[kNumAxes + 1];
+    UINT32 joystickButtons;
+
+    DoubleSolenoid::Value launch;
+    DoubleSolenoid::Value lock;
+    DoubleSolenoid::Value blocker;
+    bool lockingLS;
+    bool compressorEnabled;
+    bool pressureSwitch;        // true once the tank is full
+    float batteryVoltage;
+
+    float gyroAngle;
+    double timerLaunch;
+    double timerAuto;
+
+    TargetRecord target;
+    bool newTarget;
+
+    bool controllerButton(int button) const {
+        return (controllerButtons >> (button - 1)) & 1;
+    }
+    bool joystickButton(int button) const {
+        return (joystickButtons >> (button - 1)) & 1;
+    }
+};
+
+#endif
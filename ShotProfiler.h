@@ -0,0 +1,262 @@
+#ifndef SHOT_PROFILER_H
+#define SHOT_PROFILER_H
+
+#include "WPILib.h"
+#include "NetworkTables/NetworkTable.h"
+#include "LoopTimer.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+/* Where the time between shots goes.
+ *
+ * The launcher reports its state with setState() whenever it works it out,
+ * the trigger with setTrigger() and each shot with shotFired(); each change
+ * is stamped with the FPGA clock in microseconds. When the launcher leaves
+ * a state, the whole stay goes into that state's dwell histogram. A shot
+ * cycle runs from one shot to the next (the first from start()) and is
+ * broken down by the time each state spent in it. The press that fires a
+ * shot splits it further: coming after the launcher got ready, the time in
+ * between is the driver's reaction; coming before, it is the driver
+ * waiting on the launcher.
+ *
+ * start() begins the driving (teleop), pause() stops the clock for a
+ * disabled robot and clear() starts a new match. publish() puts the summary on a NetworkTable and dump() prints it;
+ * both are meant for the end of a match. Recording never allocates.
+ */
+class ShotProfiler {
+public:
+    static const int kMaxStates = 8;
+    static const int kMaxShots = 40;    // shot cycles kept for the per-shot lines
+
+    ShotProfiler(const char *tableName = "Shot Profile") {
+        table = NetworkTable::GetTable(tableName);
+        numStates = 0;
+        clear();
+    }
+    // States are numbered in the order they are added, to match the
+    // caller's enum; names must stay put (string literals)
+    int addState(const char *name, bool ready = false) {
+        if (numStates == kMaxStates)
+            return -1;
+        State &state = states[numStates];
+        state.name = name;
+        state.ready = ready;
+        std::string prefix(name);
+        state.keys[0] = prefix + " mean s";
+        state.keys[1] = prefix + " p90 s";
+        state.keys[2] = prefix + " per shot s";
+        return numStates++;
+    }
+    // A new match: drops everything recorded
+    void clear() {
+        for (int i = 0; i < numStates; i++)
+            states[i].dwell.reset();
+        current = -1;
+        enteredAt = 0;
+        countedFrom = 0;
+        readySince = 0;
+        triggerHeld = false;
+        pressedAt = 0;
+        memset(&cycle, 0, sizeof(cycle));
+        memset(&total, 0, sizeof(total));
+        shots = 0;
+        cycles.reset();
+    }
+    // The driver takes over: the shot cycle under way, and the driver's
+    // reaction to a launcher that is already ready, count from now
+    void start() {
+        UINT32 now = GetFPGATime();
+        memset(&cycle, 0, sizeof(cycle));
+        countedFrom = now;
+        readySince = now;
+        pressedAt = now;
+    }
+    // Disabled: the state and trigger are forgotten and nothing counts
+    // until the next setState()
+    void pause() {
+        UINT32 now = GetFPGATime();
+        leaveState(now);
+        current = -1;
+        triggerHeld = false;
+    }
+    void setState(int state) {
+        if (state == current || state < 0 || state >= numStates)
+            return;
+        UINT32 now = GetFPGATime();
+        leaveState(now);
+        current = state;
+        enteredAt = now;
+        countedFrom = now;
+        if (states[state].ready)
+            readySince = now;
+    }
+    void setTrigger(bool held) {
+        if (held == triggerHeld)
+            return;
+        triggerHeld = held;
+        if (held)
+            pressedAt = GetFPGATime();
+    }
+    void shotFired() {
+        if (current < 0)
+            return;
+        UINT32 now = GetFPGATime();
+        // the state goes on, but its time up to now belongs to this cycle
+        cycle.states[current] += now - countedFrom;
+        countedFrom = now;
+        // split by the press that fired it: before the launcher was ready
+        // the driver waited, after it the launcher did
+        if (states[current].ready && triggerHeld) {
+            if ((INT32) (pressedAt - readySince) >= 0)
+                cycle.reaction = pressedAt - readySince;
+            else
+                cycle.waited = readySince - pressedAt;
+        }
+        UINT32 length = 0;
+        for (int i = 0; i < numStates; i++) {
+            length += cycle.states[i];
+            total.states[i] += cycle.states[i];
+        }
+        cycle.length = length;
+        total.length += length;
+        total.reaction += cycle.reaction;
+        total.waited += cycle.waited;
+        if (shots < kMaxShots)
+            kept[shots] = cycle;
+        shots++;
+        cycles.record(length);
+        memset(&cycle, 0, sizeof(cycle));
+    }
+    bool empty() {
+        if (shots > 0)
+            return false;
+        for (int i = 0; i < numStates; i++)
+            if (states[i].dwell.count() > 0)
+                return false;
+        return true;
+    }
+    void publish() {
+        for (int i = 0; i < numStates; i++) {
+            State &state = states[i];
+            table->PutNumber(state.keys[0], state.dwell.mean() / 1e6);
+            table->PutNumber(state.keys[1], state.dwell.percentile(0.90) / 1e6);
+            table->PutNumber(state.keys[2], perShot(total.states[i]));
+        }
+        table->PutNumber("shots", shots);
+        table->PutNumber("cycle mean s", cycles.mean() / 1e6);
+        table->PutNumber("cycle p50 s", cycles.percentile(0.50) / 1e6);
+        table->PutNumber("reaction per shot s", perShot(total.reaction));
+        table->PutNumber("waited per shot s", perShot(total.waited));
+        int slowest = slowestState();
+        table->PutString("slowest stage", slowest < 0 ? "none" : states[slowest].name);
+    }
+    void dump(FILE *out = stdout) {
+        fprintf(out, "%-22s %8s %9s %9s %9s %9s %10s\n", "launcher states", "entries",
+                "mean s", "p50 s", "p90 s", "max s", "per shot s");
+        for (int i = 0; i < numStates; i++) {
+            State &state = states[i];
+            if (state.dwell.count() == 0)
+                continue;
+            fprintf(out, "%-22s %8ld %9.3f %9.3f %9.3f %9.3f %10.3f\n", state.name,
+                    state.dwell.count(), state.dwell.mean() / 1e6,
+                    state.dwell.percentile(0.50) / 1e6, state.dwell.percentile(0.90) / 1e6,
+                    state.dwell.max() / 1e6, perShot(total.states[i]));
+        }
+        if (shots == 0) {
+            fprintf(out, "  no shots\n");
+            return;
+        }
+        int slowest = slowestState();
+        fprintf(out, "  %d shots, cycle mean %.2f s, p50 %.2f s, max %.2f s; slowest stage %s (%.0f%%)\n",
+                shots, cycles.mean() / 1e6, cycles.percentile(0.50) / 1e6, cycles.max() / 1e6,
+                slowest < 0 ? "none" : states[slowest].name,
+                slowest < 0 ? 0.0 : share(total.states[slowest], total.length));
+        fprintf(out, "  per shot: driver reaction %.2f s, driver waiting on the launcher %.2f s\n",
+                perShot(total.reaction), perShot(total.waited));
+        fprintf(out, "  %4s %8s", "shot", "cycle s");
+        for (int i = 0; i < numStates; i++)
+            fprintf(out, " %8.8s", states[i].name);
+        fprintf(out, " %8s %8s\n", "reaction", "waited");
+        int listed = shots < kMaxShots ? shots : kMaxShots;
+        for (int n = 0; n < listed; n++) {
+            Cycle &shot = kept[n];
+            fprintf(out, "  %4d %8.2f", n + 1, shot.length / 1e6);
+            for (int i = 0; i < numStates; i++)
+                fprintf(out, " %8.2f", shot.states[i] / 1e6);
+            fprintf(out, " %8.2f %8.2f\n", shot.reaction / 1e6, shot.waited / 1e6);
+        }
+    }
+    // Adds the report to the end of a file; a null path writes nothing
+    void writeReport(const char *path) {
+        if (!path)
+            return;
+        FILE *file = fopen(path, "a");
+        if (!file)
+            return;
+        fprintf(file, "shot profile at %.1f s\n", GetFPGATime() / 1e6);
+        dump(file);
+        fclose(file);
+    }
+private:
+    struct State {
+        const char *name;
+        bool ready;
+        LatencyHistogram dwell;
+        std::string keys[3];
+    };
+    // microseconds spent in each part of a shot cycle
+    struct Cycle {
+        UINT32 length;
+        UINT32 states[kMaxStates];
+        UINT32 reaction;
+        UINT32 waited;
+    };
+    // totals over a match don't fit 32 bits of microseconds
+    struct Totals {
+        UINT64 length;
+        UINT64 states[kMaxStates];
+        UINT64 reaction;
+        UINT64 waited;
+    };
+
+    void leaveState(UINT32 now) {
+        if (current < 0)
+            return;
+        states[current].dwell.record(now - enteredAt);
+        cycle.states[current] += now - countedFrom;
+    }
+    double perShot(UINT64 micros) {
+        return shots ? micros / 1e6 / shots : 0.0;
+    }
+    static double share(UINT64 part, UINT64 whole) {
+        return whole ? 100.0 * part / whole : 0.0;
+    }
+    // The state the finished shot cycles spent longest in
+    int slowestState() {
+        int slowest = -1;
+        for (int i = 0; i < numStates; i++)
+            if (total.states[i] > 0 && (slowest < 0 || total.states[i] > total.states[slowest]))
+                slowest = i;
+        return slowest;
+    }
+
+    NetworkTable *table;
+    State states[kMaxStates];
+    int numStates;
+
+    int current;                // -1 while paused
+    UINT32 enteredAt;
+    UINT32 countedFrom;         // the stay before this is in a cycle already
+    UINT32 readySince;          // when the launcher last became ready
+    bool triggerHeld;
+    UINT32 pressedAt;
+
+    Cycle cycle;                // the one under way
+    Totals total;
+    Cycle kept[kMaxShots];
+    int shots;
+    LatencyHistogram cycles;
+};
+
+#endif
@@ -0,0 +1,377 @@
+#ifndef STATUS_PUBLISHER_H
+#define STATUS_PUBLISHER_H
+
+#include "WPILib.h"
+#include "NetworkTables/NetworkTable.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+/* The robot status the dashboard gets, as small binary frames.
+ *
+ * A frame is a 5 byte header followed by the fields it carries, in field
+ * order, little-endian:
+ *
+ *   byte  0     version
+ *   byte  1     sequence number, one more each frame
+ *   bytes 2-3   fields carried, bit n for field n; bit 15 marks a keyframe,
+ *               which carries every field
+ *   byte  4     sequence number of the keyframe this frame builds on (its
+ *               own for a keyframe)
+ *
+ * A frame that isn't a keyframe carries every field that differs from its
+ * keyframe, so the newest frame and its keyframe together are the whole
+ * status; the frames in between can be lost.
+ *
+ *   field                 bytes  units
+ *   0 launcher status     1      eLauncherStatus
+ *   1 autonomous state    1
+ *   2 solenoids           1      launch | lock << 2 | blocker << 4
+ *   3 gyro angle          2      0.01 deg, wrapped to +-180
+ *   4 launch timer        2      0.01 s
+ *   5 autonomous timer    2      0.01 s
+ *   6 strafe              1      1/127 of full output
+ *   7 speed               1      1/127
+ *   8 rotation            1      1/127
+ *
+ * NetworkTables only carries text, so a frame goes out base64 encoded as
+ * the "frame" string.
+ */
+class StatusCodec {
+public:
+    enum Field {LAUNCHER_STATUS, AUTONOMOUS_STATE, SOLENOIDS, GYRO_ANGLE, LAUNCH_TIMER,
+                AUTONOMOUS_TIMER, DRIVE_STRAFE, DRIVE_SPEED, DRIVE_ROTATION, kNumFields};
+    static const int kVersion = 2;
+    static const int kHeaderSize = 5;
+    static const int kMaxFrameSize = kHeaderSize + 12;
+    static const int kMaxTextSize = (kMaxFrameSize + 2) / 3 * 4 + 1;
+    static const UINT16 kKeyframe = 0x8000;
+
+    struct FieldInfo {
+        const char *name;
+        int bytes;
+        bool isSigned;
+        float scale;            // counts per unit
+    };
+    static const FieldInfo &info(int field) {
+        static const FieldInfo fields[kNumFields] = {
+            {"launcher", 1, false, 1.0f},
+            {"auto state", 1, false, 1.0f},
+            {"solenoids", 1, false, 1.0f},
+            {"gyro", 2, true, 100.0f},
+            {"launch timer", 2, false, 100.0f},
+            {"auto timer", 2, false, 100.0f},
+            {"strafe", 1, true, 127.0f},
+            {"speed", 1, true, 127.0f},
+            {"rotation", 1, true, 127.0f},
+        };
+        return fields[field];
+    }
+    // The field's counts for value, clamped to what its bytes hold
+    static INT32 quantize(int field, float value) {
+        const FieldInfo &about = info(field);
+        INT32 counts = (INT32) floor(value * about.scale + 0.5f);
+        INT32 largest = about.isSigned ? (1 << (8 * about.bytes - 1)) - 1 : (1 << (8 * about.bytes)) - 1;
+        INT32 smallest = about.isSigned ? -largest : 0;
+        return counts > largest ? largest : counts < smallest ? smallest : counts;
+    }
+    static float toValue(int field, INT32 counts) {
+        return counts / info(field).scale;
+    }
+    static int putField(int field, INT32 counts, UINT8 *bytes) {
+        for (int i = 0; i < info(field).bytes; i++)
+            bytes[i] = (UINT8) (counts >> (8 * i));
+        return info(field).bytes;
+    }
+    static int getField(int field, const UINT8 *bytes, INT32 &counts) {
+        const FieldInfo &about = info(field);
+        UINT32 raw = 0;
+        for (int i = 0; i < about.bytes; i++)
+            raw |= (UINT32) bytes[i] << (8 * i);
+        int unused = 32 - 8 * about.bytes;
+        counts = about.isSigned ? (INT32) (raw << unused) >> unused : (INT32) raw;
+        return about.bytes;
+    }
+    // Base64, NUL terminated; text needs kMaxTextSize
+    static void toText(const UINT8 *bytes, int size, char *text) {
+        static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (int i = 0; i < size; i += 3) {
+            UINT32 group = bytes[i] << 16 | (i + 1 < size ? bytes[i + 1] << 8 : 0)
+                           | (i + 2 < size ? bytes[i + 2] : 0);
+            *text++ = digits[group >> 18 & 63];
+            *text++ = digits[group >> 12 & 63];
+            *text++ = i + 1 < size ? digits[group >> 6 & 63] : '=';
+            *text++ = i + 2 < size ? digits[group & 63] : '=';
+        }
+        *text = '\0';
+    }
+    // Frame size, or -1 for text that isn't a frame's
+    static int fromText(const char *text, UINT8 *bytes) {
+        int length = (int) strlen(text);
+        if (length % 4 != 0 || length > kMaxTextSize - 1)
+            return -1;
+        int size = 0;
+        for (int i = 0; i < length; i += 4) {
+            UINT32 group = 0;
+            int padding = 0;
+            for (int j = 0; j < 4; j++) {
+                int digit = digitOf(text[i + j]);
+                // '=' only pads the end of the last group
+                if (text[i + j] == '=' && i + 4 == length && j >= 2) {
+                    padding++;
+                    digit = 0;
+                }
+                else if (digit < 0 || padding > 0)
+                    return -1;
+                group = group << 6 | digit;
+            }
+            for (int j = 0; j < 3 - padding; j++) {
+                if (size == kMaxFrameSize)
+                    return -1;
+                bytes[size++] = (UINT8) (group >> (16 - 8 * j));
+            }
+        }
+        return size;
+    }
+private:
+    static int digitOf(char c) {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return -1;
+    }
+};
+
+/* Sends the status fields that have changed.
+ *
+ * set() only stores a field's counts; flush() is called once per window.
+ * A field that changed is updated once its own interval has gone by since
+ * it was last updated, so a timer that changes every cycle goes out a few
+ * times a second while a launcher state change goes out in the next window.
+ * When anything was updated, one frame goes out holding every field that
+ * differs from the last keyframe, not only the ones updated this window:
+ * NetworkTables sends only the last value put in each write period (100 ms),
+ * so the dashboard may never see the frames before it. Every keyframePeriod
+ * a keyframe carries all of the fields, so a dashboard that connected late
+ * catches up. Nothing is written when nothing is due.
+ */
+class StatusPublisher {
+public:
+    StatusPublisher(const char *tableName = "Robot Status", double keyframePeriod = 1.0) {
+        table = NetworkTable::GetTable(tableName);
+        key = "frame";
+        keyframeEvery = keyframePeriod;
+        for (int i = 0; i < StatusCodec::kNumFields; i++) {
+            values[i] = 0;
+            sent[i] = 0;
+            keyValues[i] = 0;
+            sentAt[i] = -1e9;
+            interval[i] = 0.0;
+        }
+        lastKeyframe = -1e9;
+        sequence = 0;
+        keySequence = 0;
+        clearStats();
+    }
+    // The shortest time between two sends of a field that keeps changing
+    void setInterval(int field, double seconds) {
+        interval[field] = seconds;
+    }
+    void set(int field, float value) {
+        values[field] = StatusCodec::quantize(field, value);
+    }
+    // Sends what is due; true if a frame went out
+    bool flush(double now) {
+        flushes++;
+        UINT16 fields = 0;
+        bool keyframe = now - lastKeyframe >= keyframeEvery;
+        bool updated = false;
+        for (int i = 0; i < StatusCodec::kNumFields; i++) {
+            if (keyframe || (values[i] != sent[i] && now - sentAt[i] >= interval[i])) {
+                updated = updated || values[i] != sent[i];
+                sent[i] = values[i];
+                sentAt[i] = now;
+            }
+        }
+        if (keyframe) {
+            fields = StatusCodec::kKeyframe | ((1 << StatusCodec::kNumFields) - 1);
+            for (int i = 0; i < StatusCodec::kNumFields; i++)
+                keyValues[i] = sent[i];
+            keySequence = sequence;
+            lastKeyframe = now;
+            keyframes++;
+        }
+        else if (updated) {
+            for (int i = 0; i < StatusCodec::kNumFields; i++)
+                if (sent[i] != keyValues[i])
+                    fields |= 1 << i;
+        }
+        if (!keyframe && !updated)
+            return false;
+
+        UINT8 frame[StatusCodec::kMaxFrameSize];
+        frame[0] = StatusCodec::kVersion;
+        frame[1] = sequence++;
+        frame[2] = (UINT8) fields;
+        frame[3] = (UINT8) (fields >> 8);
+        frame[4] = keySequence;
+        int size = StatusCodec::kHeaderSize;
+        for (int i = 0; i < StatusCodec::kNumFields; i++) {
+            if (!(fields & (1 << i)))
+                continue;
+            size += StatusCodec::putField(i, sent[i], frame + size);
+            fieldsSent++;
+        }
+        char text[StatusCodec::kMaxTextSize];
+        StatusCodec::toText(frame, size, text);
+        table->PutString(key, text);
+        frames++;
+        bytesSent += strlen(text);
+        return true;
+    }
+    void clearStats() {
+        flushes = 0;
+        frames = 0;
+        keyframes = 0;
+        fieldsSent = 0;
+        bytesSent = 0;
+    }
+    void dump(FILE *out = stdout) {
+        if (flushes == 0)
+            return;
+        // what a full frame every window would have cost
+        long fullBytes = flushes * (long) (StatusCodec::kMaxTextSize - 1);
+        fprintf(out, "status: %ld frames in %ld windows (%ld keyframes), %.1f fields a frame, "
+                "%ld bytes (%.0f%% of sending everything)\n",
+                frames, flushes, keyframes, frames ? (double) fieldsSent / frames : 0.0,
+                bytesSent, fullBytes ? 100.0 * bytesSent / fullBytes : 0.0);
+    }
+private:
+    NetworkTable *table;
+    std::string key;
+    double keyframeEvery;
+    INT32 values[StatusCodec::kNumFields];
+    INT32 sent[StatusCodec::kNumFields];        // what the dashboard has been told
+    INT32 keyValues[StatusCodec::kNumFields];   // what the last keyframe carried
+    double sentAt[StatusCodec::kNumFields];
+    double interval[StatusCodec::kNumFields];
+    double lastKeyframe;
+    UINT8 sequence;
+    UINT8 keySequence;
+
+    long flushes;
+    long frames;
+    long keyframes;
+    long fieldsSent;
+    long bytesSent;
+};
+
+/* The dashboard's side. A keyframe sets every field; any other frame sets
+ * the fields it carries and puts the rest back to its keyframe's values.
+ * Frames lost in between (a sequence number that doesn't follow the last
+ * one) are only counted. A frame whose keyframe never arrived leaves the
+ * fields it doesn't carry stale until the next keyframe.
+ */
+class StatusDecoder {
+public:
+    StatusDecoder() {
+        memset(known, 0, sizeof(known));
+        memset(counts, 0, sizeof(counts));
+        memset(keyCounts, 0, sizeof(keyCounts));
+        lastFields = 0;
+        haveSequence = false;
+        haveKeyframe = false;
+        keySequence = 0;
+        stale = true;
+        frames = 0;
+        gaps = 0;
+        bad = 0;
+    }
+    // False for text that isn't a frame of this version
+    bool decode(const char *text) {
+        UINT8 frame[StatusCodec::kMaxFrameSize];
+        int size = StatusCodec::fromText(text, frame);
+        if (size < StatusCodec::kHeaderSize || frame[0] != StatusCodec::kVersion) {
+            bad++;
+            return false;
+        }
+        UINT16 fields = (UINT16) (frame[2] | frame[3] << 8);
+        INT32 carried[StatusCodec::kNumFields];
+        int at = StatusCodec::kHeaderSize;
+        for (int i = 0; i < StatusCodec::kNumFields; i++) {
+            if (!(fields & (1 << i)))
+                continue;
+            if (at + StatusCodec::info(i).bytes > size) {
+                bad++;
+                return false;
+            }
+            at += StatusCodec::getField(i, frame + at, carried[i]);
+        }
+        if (fields & StatusCodec::kKeyframe) {
+            for (int i = 0; i < StatusCodec::kNumFields; i++)
+                keyCounts[i] = carried[i];
+            keySequence = frame[1];
+            haveKeyframe = true;
+        }
+        stale = !haveKeyframe || frame[4] != keySequence;
+        for (int i = 0; i < StatusCodec::kNumFields; i++) {
+            if (fields & (1 << i)) {
+                counts[i] = carried[i];
+                known[i] = true;
+            }
+            else if (!stale) {
+                counts[i] = keyCounts[i];
+                known[i] = true;
+            }
+        }
+        if (haveSequence && frame[1] != (UINT8) (sequence + 1))
+            gaps++;
+        sequence = frame[1];
+        haveSequence = true;
+        lastFields = fields;
+        frames++;
+        return true;
+    }
+    bool isKnown(int field) {
+        return known[field];
+    }
+    float value(int field) {
+        return StatusCodec::toValue(field, counts[field]);
+    }
+    // Fields the last frame carried, with the keyframe bit
+    UINT16 changed() {
+        return lastFields;
+    }
+    // The last frame's keyframe never arrived, so the fields it didn't
+    // carry may be out of date
+    bool isStale() {
+        return stale;
+    }
+    long frameCount() {
+        return frames;
+    }
+    long gapCount() {
+        return gaps;
+    }
+    long badCount() {
+        return bad;
+    }
+private:
+    bool known[StatusCodec::kNumFields];
+    INT32 counts[StatusCodec::kNumFields];
+    INT32 keyCounts[StatusCodec::kNumFields];
+    UINT16 lastFields;
+    UINT8 sequence;
+    bool haveSequence;
+    bool haveKeyframe;
+    UINT8 keySequence;
+    bool stale;
+    long frames;
+    long gaps;
+    long bad;
+};
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef TELEMETRY_RECORDER_H
+#define TELEMETRY_RECORDER_H
+
+#include "WPILib.h"
+#include "RobotSnapshot.h"
+#include "MemoryBarrier.h"
+#include <stdio.h>
+#include <string.h>
+
+/* One periodic cycle of the 2014 robot: what it read and what it did with
+ * it. Inputs are copied from the snapshot by setInputs() right after
+ * readInputs(); outputs are filled in as the cycle runs.
+ */
+struct TelemetryRecord {
+    enum Mode {DISABLED, AUTONOMOUS, TELEOP};
+
+    UINT32 sequence;
+    UINT32 time;                 // FPGA time in microseconds
+    UINT8 mode;
+
+    // inputs
+    float controllerAxes[RobotSnapshot::kNumAxes];
+    float joystickAxes[RobotSnapshot::kNumAxes];
+    UINT16 controllerButtons;
+    UINT16 joystickButtons;
+    UINT8 launchIn, lockIn, blockerIn;
+    bool lockingLS;
+    bool compressorEnabled;
+    bool pressureSwitch;
+    float batteryVoltage;
+    float gyroAngle;
+    float timerLaunch;
+    float timerAuto;
+
+    // outputs
+    float driveX, driveY, driveRotation;
+    UINT8 launchOut, lockOut, blockerOut;
+    UINT8 launcherStatus;
+    UINT8 autonomousState;
+    UINT8 launching;             // a shot is under way
+    float tankPressure;          // estimated, psi
+    float launcherPressure;
+    float driveLimit;            // fraction of the drive output the power manager allowed
+    bool compressorHeld;         // the power manager held the compressor off
+
+    void setInputs(const RobotSnapshot &in) {
+        time = (UINT32) (in.time * 1e6);
+        memcpy(controllerAxes, in.controllerAxes + 1, sizeof(controllerAxes));
+        memcpy(joystickAxes, in.joystickAxes + 1, sizeof(joystickAxes));
+        controllerButtons = (UINT16) in.controllerButtons;
+        joystickButtons = (UINT16) in.joystickButtons;
+        launchIn = in.launch;
+        lockIn = in.lock;
+        blockerIn = in.blocker;
+        lockingLS = in.lockingLS;
+        compressorEnabled = in.compressorEnabled;
+        pressureSwitch = in.pressureSwitch;
+        batteryVoltage = in.batteryVoltage;
+        gyroAngle = in.gyroAngle;
+        timerLaunch = (float) in.timerLaunch;
+        timerAuto = (float) in.timerAuto;
+    }
+    // The snapshot's solenoid fields hold what was written during the cycle
+    void setSolenoidOutputs(const RobotSnapshot &in) {
+        launchOut = in.launch;
+        lockOut = in.lock;
+        blockerOut = in.blocker;
+    }
+};
+
+/* Telemetry files start with an 8 byte header ("TMTL", version, record
+ * size, two reserved bytes) followed by fixed-size little-endian records:
+ *
+ *   bytes 0-3   sequence number
+ *   bytes 4-7   time (microseconds)
+ *   byte  8     mode
+ *   byte  9     launcher status
+ *   byte  10    autonomous state
+ *   byte  11    launching
+ *   bytes 12-35 controller axes 1-6 (floats)
+ *   bytes 36-59 joystick axes 1-6 (floats)
+ *   bytes 60-61 controller buttons
+ *   bytes 62-63 joystick buttons
+ *   byte  64    solenoids read: launch | lock << 2 | blocker << 4 | locking LS << 6
+ *   byte  65    solenoids written: launch | lock << 2 | blocker << 4
+ *   byte  66    compressor enabled | pressure switch << 1 | compressor held << 2
+ *   byte  67    reserved
+ *   bytes 68-79 gyro angle, launch timer, autonomous timer (floats)
+ *   bytes 80-91 drive x, y, rotation (floats)
+ *   bytes 92-99 estimated tank and launcher pressure (floats)
+ *   bytes 100-107 battery voltage, drive limit (floats)
+ */
+class TelemetryCodec {
+public:
+    static const int kVersion = 3;
+    static const int kHeaderSize = 8;
+    static const int kRecordSize = 108;
+
+    static void encodeHeader(UINT8 *bytes) {
+        memcpy(bytes, "TMTL", 4);
+        bytes[4] = kVersion;
+        bytes[5] = kRecordSize;
+        bytes[6] = 0;
+        bytes[7] = 0;
+    }
+    static bool decodeHeader(const UINT8 *bytes) {
+        return memcmp(bytes, "TMTL", 4) == 0 && bytes[4] == kVersion && bytes[5] == kRecordSize;
+    }
+    static void encode(const TelemetryRecord &record, UINT8 *bytes) {
+        memset(bytes, 0, kRecordSize);
+        putInt(bytes, record.sequence);
+        putInt(bytes + 4, record.time);
+        bytes[8] = record.mode;
+        bytes[9] = record.launcherStatus;
+        bytes[10] = record.autonomousState;
+        bytes[11] = record.launching;
+        for (int i = 0; i < RobotSnapshot::kNumAxes; i++) {
+            putFloat(bytes + 12 + 4*i, record.controllerAxes[i]);
+            putFloat(bytes + 36 + 4*i, record.joystickAxes[i]);
+        }
+        putShort(bytes + 60, record.controllerButtons);
+        putShort(bytes + 62, record.joystickButtons);
+        bytes[64] = (UINT8) ((record.launchIn & 3) | (record.lockIn & 3) << 2
+                             | (record.blockerIn & 3) << 4 | (record.lockingLS ? 1 : 0) << 6);
+        bytes[65] = (UINT8) ((record.launchOut & 3) | (record.lockOut & 3) << 2
+                             | (record.blockerOut & 3) << 4);
+        bytes[66] = (UINT8) ((record.compressorEnabled ? 1 : 0) | (record.pressureSwitch ? 1 : 0) << 1
+                             | (record.compressorHeld ? 1 : 0) << 2);
+        putFloat(bytes + 68, record.gyroAngle);
+        putFloat(bytes + 72, record.timerLaunch);
+        putFloat(bytes + 76, record.timerAuto);
+        putFloat(bytes + 80, record.driveX);
+        putFloat(bytes + 84, record.driveY);
+        putFloat(bytes + 88, record.driveRotation);
+        putFloat(bytes + 92, record.tankPressure);
+        putFloat(bytes + 96, record.launcherPressure);
+        putFloat(bytes + 100, record.batteryVoltage);
+        putFloat(bytes + 104, record.driveLimit);
+    }
+    static void decode(const UINT8 *bytes, TelemetryRecord &record) {
+        record.sequence = getInt(bytes);
+        record.time = getInt(bytes + 4);
+        record.mode = bytes[8];
+        record.launcherStatus = bytes[9];
+        record.autonomousState = bytes[10];
+        record.launching = bytes[11];
+        for (int i = 0; i < RobotSnapshot::kNumAxes; i++) {
+            record.controllerAxes[i] = getFloat(bytes + 12 + 4*i);
+            record.joystickAxes[i] = getFloat(bytes + 36 + 4*i);
+        }
+        record.controllerButtons = bytes[60] | bytes[61] << 8;
+        record.joystickButtons = bytes[62] | bytes[63] << 8;
+        record.launchIn = bytes[64] & 3;
+        record.lockIn = bytes[64] >> 2 & 3;
+        record.blockerIn = bytes[64] >> 4 & 3;
+        record.lockingLS = (bytes[64] >> 6 & 1) != 0;
+        record.launchOut = bytes[65] & 3;
+        record.lockOut = bytes[65] >> 2 & 3;
+        record.blockerOut = bytes[65] >> 4 & 3;
+        record.compressorEnabled = (bytes[66] & 1) != 0;
+        record.pressureSwitch = (bytes[66] >> 1 & 1) != 0;
+        record.compressorHeld = (bytes[66] >> 2 & 1) != 0;
+        record.gyroAngle = getFloat(bytes + 68);
+        record.timerLaunch = getFloat(bytes + 72);
+        record.timerAuto = getFloat(bytes + 76);
+        record.driveX = getFloat(bytes + 80);
+        record.driveY = getFloat(bytes + 84);
+        record.driveRotation = getFloat(bytes + 88);
+        record.tankPressure = getFloat(bytes + 92);
+        record.launcherPressure = getFloat(bytes + 96);
+        record.batteryVoltage = getFloat(bytes + 100);
+        record.driveLimit = getFloat(bytes + 104);
+    }
+private:
+    static void putShort(UINT8 *bytes, UINT16 value) {
+        bytes[0] = (UINT8) value;
+        bytes[1] = (UINT8) (value >> 8);
+    }
+    static void putInt(UINT8 *bytes, UINT32 value) {
+        for (int i = 0; i < 4; i++)
+            bytes[i] = (UINT8) (value >> (8*i));
+    }
+    static UINT32 getInt(const UINT8 *bytes) {
+        return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (UINT32) bytes[3] << 24;
+    }
+    static void putFloat(UINT8 *bytes, float value) {
+        UINT32 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        putInt(bytes, bits);
+    }
+    static float getFloat(const UINT8 *bytes) {
+        UINT32 bits = getInt(bytes);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+/* Records every cycle to a file without ever making the periodic loop wait.
+ *
+ * record() copies the record into a preallocated single-producer,
+ * single-consumer ring and returns; if the ring is full the record is
+ * dropped and counted. A low-priority task drains the ring every
+ * drainPeriod, encodes the records and writes them to the file. Only the
+ * robot task may call record(), and only the drain task takes records out,
+ * so the two indexes need nothing more than memory barriers.
+ *
+ * A null path turns recording off: no file, no task, and record() returns
+ * straight away.
+ */
+class TelemetryRecorder {
+public:
+    static const int kCapacity = 512;   // about 5 s of 100 Hz cycles
+
+    TelemetryRecorder(const char *path, double drainPeriod = 0.1) {
+        period = drainPeriod;
+        head = 0;
+        tail = 0;
+        sequence = 0;
+        dropped = 0;
+        written = 0;
+        running = true;
+        finished = false;
+        file = 0;
+        task = 0;
+        if (!path)
+            return;
+        file = fopen(path, "wb");
+        if (file) {
+            UINT8 header[TelemetryCodec::kHeaderSize];
+            TelemetryCodec::encodeHeader(header);
+            fwrite(header, sizeof(header), 1, file);
+        }
+        task = new Task("TelemetryDrain", (FUNCPTR) TelemetryRecorder::drainTask, 150);
+        task->Start((size_t) this);
+    }
+    // Stops the drain task after it has written everything left in the ring
+    virtual ~TelemetryRecorder() {
+        if (!task)
+            return;
+        running = false;
+        while (!finished)
+            Wait(period);
+        delete task;
+        if (file)
+            fclose(file);
+    }
+    // Called from the periodic loop; never blocks or allocates
+    void record(TelemetryRecord &cycle) {
+        if (!task)
+            return;
+        cycle.sequence = ++sequence;
+        UINT32 next = (head + 1) % kCapacity;
+        if (next == tail) {
+            dropped++;
+            return;
+        }
+        ring[head] = cycle;
+        MEMORY_BARRIER();           // the record is in place before head moves
+        head = next;
+    }
+    long recordsDropped() {
+        return dropped;
+    }
+    long recordsWritten() {
+        return written;
+    }
+private:
+    static int drainTask(TelemetryRecorder *recorder) {
+        while (recorder->running) {
+            recorder->drain();
+            Wait(recorder->period);
+        }
+        recorder->drain();
+        recorder->finished = true;
+        return 0;
+    }
+    void drain() {
+        UINT8 bytes[TelemetryCodec::kRecordSize];
+        bool wrote = false;
+        while (tail != head) {
+            MEMORY_BARRIER();       // read the record only after seeing head
+            TelemetryCodec::encode(ring[tail], bytes);
+            MEMORY_BARRIER();       // done with the slot before handing it back
+            tail = (tail + 1) % kCapacity;
+            if (file && fwrite(bytes, sizeof(bytes), 1, file) == 1) {
+                written++;
+                wrote = true;
+            }
+        }
+        if (wrote)
+            fflush(file);
+    }
+
+    TelemetryRecord ring[kCapacity];
+    volatile UINT32 head;           // written only by record()
+    volatile UINT32 tail;           // written only by the drain task
+    UINT32 sequence;
+    long dropped;
+    long written;
+
+    FILE *file;
+    Task *task;
+    double period;
+    volatile bool running;
+    volatile bool finished;
+};
+
+#endif
@@ -0,0 +1,247 @@
+#ifndef VISION_TARGET_H
+#define VISION_TARGET_H
+
+#include "WPILib.h"
+#include "NetworkTables/NetworkTable.h"
+#include "RateExecutor.h"
+#include <string.h>
+#include <string>
+
+/* What the vision code saw in one camera frame. Offsets are in degrees from
+ * the center of the image, distance is in feet and captureTime is the FPGA
+ * time (Timer::GetFPGATimestamp()) the frame was taken at.
+ */
+struct TargetRecord {
+    bool detected;
+    float xOffset;
+    float yOffset;
+    float distance;
+    double captureTime;
+    UINT32 sequence;
+};
+
+/* Target records travel over the "Target Status Table" as one fixed-size
+ * binary record under "Target Record". The bytes are little-endian and sent
+ * as hex so the Java dashboard tables pass them through untouched.
+ *
+ *   byte  0     version
+ *   byte  1     flags (bit 0 = detected)
+ *   bytes 2-3   reserved
+ *   bytes 4-7   sequence number
+ *   bytes 8-11  x offset (float)
+ *   bytes 12-15 y offset (float)
+ *   bytes 16-19 distance (float)
+ *   bytes 20-27 capture time (double)
+ */
+class TargetCodec {
+public:
+    static const int kVersion = 1;
+    static const int kRecordSize = 28;
+    static const int kTextSize = 2 * kRecordSize;
+
+    static void encode(const TargetRecord &record, char *text) {
+        UINT8 bytes[kRecordSize];
+        memset(bytes, 0, sizeof(bytes));
+        bytes[0] = kVersion;
+        bytes[1] = record.detected ? 1 : 0;
+        putInt(bytes + 4, record.sequence);
+        putFloat(bytes + 8, record.xOffset);
+        putFloat(bytes + 12, record.yOffset);
+        putFloat(bytes + 16, record.distance);
+        UINT64 time;
+        memcpy(&time, &record.captureTime, sizeof(time));
+        putInt(bytes + 20, (UINT32) time);
+        putInt(bytes + 24, (UINT32) (time >> 32));
+        static const char digits[] = "0123456789abcdef";
+        for (int i = 0; i < kRecordSize; i++) {
+            text[2*i] = digits[bytes[i] >> 4];
+            text[2*i + 1] = digits[bytes[i] & 0xf];
+        }
+        text[kTextSize] = '\0';
+    }
+    static bool decode(const char *text, int length, TargetRecord &record) {
+        if (length != kTextSize)
+            return false;
+        UINT8 bytes[kRecordSize];
+        for (int i = 0; i < kRecordSize; i++) {
+            int high = hexDigit(text[2*i]);
+            int low = hexDigit(text[2*i + 1]);
+            if (high < 0 || low < 0)
+                return false;
+            bytes[i] = (UINT8) (high << 4 | low);
+        }
+        if (bytes[0] != kVersion)
+            return false;
+        record.detected = (bytes[1] & 1) != 0;
+        record.sequence = getInt(bytes + 4);
+        record.xOffset = getFloat(bytes + 8);
+        record.yOffset = getFloat(bytes + 12);
+        record.distance = getFloat(bytes + 16);
+        UINT64 time = getInt(bytes + 20) | (UINT64) getInt(bytes + 24) << 32;
+        memcpy(&record.captureTime, &time, sizeof(time));
+        return true;
+    }
+private:
+    static void putInt(UINT8 *bytes, UINT32 value) {
+        for (int i = 0; i < 4; i++)
+            bytes[i] = (UINT8) (value >> (8*i));
+    }
+    static UINT32 getInt(const UINT8 *bytes) {
+        return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (UINT32) bytes[3] << 24;
+    }
+    static void putFloat(UINT8 *bytes, float value) {
+        UINT32 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        putInt(bytes, bits);
+    }
+    static float getFloat(const UINT8 *bytes) {
+        UINT32 bits = getInt(bytes);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    static int hexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+};
+
+/* Robot side of the target channel. The NetworkTables thread decodes each
+ * new record as it arrives and publishes it straight to the robot's
+ * mailbox, so the periodic loop picks it up on its next cycle by copying a
+ * struct.
+ */
+class TargetChannel : public ITableListener {
+public:
+    static const char *key() {
+        return "Target Record";
+    }
+
+    TargetChannel(NetworkTable *targetTable, SnapshotMailbox<TargetRecord> *targetMailbox) {
+        table = targetTable;
+        mailbox = targetMailbox;
+        received = 0;
+        rejected = 0;
+        table->AddTableListener(key(), this, true);
+    }
+    virtual ~TargetChannel() {
+        table->RemoveTableListener(this);
+    }
+    // Sends a record to everyone listening on the table
+    void publish(const TargetRecord &record) {
+        char text[TargetCodec::kTextSize + 1];
+        TargetCodec::encode(record, text);
+        table->PutString(key(), text);
+    }
+    long recordsReceived() {
+        return received;
+    }
+    long recordsRejected() {
+        return rejected;
+    }
+    // Only ever called from one thread at a time, so the mailbox has a
+    // single writer
+    virtual void ValueChanged(ITable *source, const std::string &changedKey, EntryValue value, bool isNew) {
+        const std::string *text = (const std::string *) value.ptr;
+        TargetRecord record;
+        if (!TargetCodec::decode(text->data(), text->size(), record)) {
+            rejected++;
+            return;
+        }
+        received++;
+        mailbox->publish(record);
+    }
+private:
+    NetworkTable *table;
+    SnapshotMailbox<TargetRecord> *mailbox;
+    long received;
+    long rejected;
+};
+
+/* Stand-in for the vision coprocessor. Publishes records through the same
+ * table and codec, so the robot side can be exercised with no camera.
+ */
+class LoopbackTargetSource {
+public:
+    LoopbackTargetSource(TargetChannel *targetChannel) {
+        channel = targetChannel;
+        sequence = 0;
+    }
+    // Reports a target seen latency seconds ago
+    void see(float xOffset, float yOffset, float distance, double latency = 0.0) {
+        send(true, xOffset, yOffset, distance, latency);
+    }
+    void lose() {
+        send(false, 0.0, 0.0, 0.0, 0.0);
+    }
+private:
+    void send(bool detected, float xOffset, float yOffset, float distance, double latency) {
+        TargetRecord record;
+        record.detected = detected;
+        record.xOffset = xOffset;
+        record.yOffset = yOffset;
+        record.distance = distance;
+        record.captureTime = Timer::GetFPGATimestamp() - latency;
+        record.sequence = ++sequence;
+        channel->publish(record);
+    }
+
+    TargetChannel *channel;
+    UINT32 sequence;
+};
+
+/* The last second or so of gyro readings, so an aim can be worked out from
+ * where the robot was pointing when the camera frame was taken.
+ */
+class GyroHistory {
+public:
+    static const int kSize = 128;
+
+    GyroHistory() {
+        count = 0;
+        next = 0;
+    }
+    void record(double time, float angle) {
+        times[next] = time;
+        angles[next] = angle;
+        next = (next + 1) % kSize;
+        if (count < kSize)
+            count++;
+    }
+    // Heading at a past time, interpolated between readings. Anything newer
+    // than the last reading gets the last reading; false if the time is
+    // older than the history.
+    bool angleAt(double time, float &angle) {
+        if (count == 0)
+            return false;
+        int newest = (next + kSize - 1) % kSize;
+        if (time >= times[newest]) {
+            angle = angles[newest];
+            return true;
+        }
+        for (int n = 0; n < count - 1; n++) {
+            int after = (newest + kSize - n) % kSize;
+            int before = (after + kSize - 1) % kSize;
+            if (times[before] <= time) {
+                double span = times[after] - times[before];
+                double fraction = span > 0.0 ? (time - times[before]) / span : 1.0;
+                angle = angles[before] + (float) ((angles[after] - angles[before]) * fraction);
+                return true;
+            }
+        }
+        return false;
+    }
+    void clear() {
+        count = 0;
+        next = 0;
+    }
+private:
+    double times[kSize];
+    float angles[kSize];
+    int count;
+    int next;
+};
+
+#endif
@@ -0,0 +1,424 @@
+/* Runs a robot's autonomous routine over and over under the mecanum drive
+ * model and reports how consistently it ends up where it should.
+ *
+ *   batch2014 [--runs N] [--threads N] [--seed N] [--time S] [--spread M]
+ *             [--turn-spread DEG] [--drift DEG/S] [--noise DEG] [--mismatch F]
+ *             [--set KEY=VALUE]... [--sweep KEY=VALUE,VALUE...]...
+ *
+ * --set puts a value in the robot's Preferences, which is where the robots
+ * read their autonomous settings (AutoAccel, AutoSpeed, HeadingP, ...) in
+ * AutonomousInit. --sweep does the same with each of its values in turn;
+ * with several sweeps every combination is a setting of its own. Each
+ * setting gets its own reference run and report, and every setting sees
+ * the same starts and models, so the differences between the reports are
+ * down to the settings.
+ *
+ * Every run starts from a random pose around the starting position with a
+ * random gyro drift and per-motor speed mismatch, then goes through
+ * DisabledInit, AutonomousInit and AutonomousPeriodic on the virtual clock.
+ * One run without any randomness is done first; its end pose, relative to
+ * where it started, is what every other run is measured against.
+ *
+ * Each worker thread builds one robot and reuses it for all of its runs,
+ * like a robot that sits through many matches without a reboot. Runs are
+ * handed out by a work-stealing pool, and each run's randomness depends
+ * only on the seed and its run number, so results don't depend on how the
+ * runs were scheduled. The robot's own output is discarded.
+ */
+#include "MecanumModel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fcntl.h>
+#include <math.h>
+#include <mutex>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+RobotBase *FRC_userClassFactory();
+
+namespace {
+
+const double kPacketPeriod = 0.020;
+const double kPi = 3.14159265358979;
+
+struct Options {
+    int runs;
+    int threads;
+    unsigned seed;
+    double duration;        // s of autonomous per run
+    double spread;          // m either side of the nominal start
+    double turnSpread;      // deg either side of the nominal heading
+    double drift;           // deg/s standard deviation of the gyro drift
+    double noise;           // deg standard deviation of each gyro reading
+    double mismatch;        // standard deviation of each motor's speed scale
+    std::vector<std::pair<std::string, std::string> > sets;
+    std::vector<std::pair<std::string, std::vector<std::string> > > sweeps;
+};
+
+// Preferences for one setting, in the order they were given
+typedef std::vector<std::pair<std::string, std::string> > Setting;
+
+struct RunResult {
+    FieldPose start;
+    FieldPose end;
+    double completeTime;    // s until the robot last moved
+    long contacts;
+};
+
+/* Hands out run numbers. Each worker starts with its own block of runs and
+ * takes from the back of its queue; a worker that runs out steals from the
+ * front of someone else's.
+ */
+class WorkStealingPool {
+public:
+    WorkStealingPool(int workers, int jobs) : m_queues(workers) {
+        for (int i = 0; i < jobs; i++)
+            m_queues[(long) i * workers / jobs].jobs.push_back(i);
+    }
+    bool Next(int worker, int &job) {
+        for (size_t n = 0; n < m_queues.size(); n++) {
+            Queue &queue = m_queues[(worker + n) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.lock);
+            if (queue.jobs.empty())
+                continue;
+            if (n == 0) {
+                job = queue.jobs.back();
+                queue.jobs.pop_back();
+            }
+            else {
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<int> jobs;
+    };
+    std::vector<Queue> m_queues;
+};
+
+// Where the robot starts: facing its own alliance wall, because both robots
+// drive out of the starting zone with a positive mecDrive y, which
+// MecanumDrive_Cartesian turns into wheels rolling backwards
+FieldPose NominalStart(const MecanumModel::Params &params) {
+    FieldPose start = {params.fieldWidth / 2.0, 1.0, 180.0};
+    return start;
+}
+
+/* One robot with its own simulated hardware and drive model. */
+class Bench {
+public:
+    Bench() {
+        m_context = new SimContext();
+        sim::SetContext(m_context);
+        m_robot = static_cast<IterativeRobot *>(FRC_userClassFactory());
+        m_robot->RobotInit();
+        // RobotCore makes the drive Talons before anything else: front left,
+        // rear left, front right, rear right
+        std::vector<Talon *> &talons = m_context->talons;
+        if (talons.size() < 4) {
+            fprintf(stderr, "the robot has no drive Talons to model\n");
+            exit(1);
+        }
+        m_model = new MecanumModel(talons[0], talons[1], talons[2], talons[3]);
+        m_context->physics = m_model;
+    }
+    RunResult Run(const Setting &setting, const FieldPose &start, const MecanumModel::Params &params,
+                  unsigned seed, double duration) {
+        SimContext &ctx = *m_context;
+        ctx.preferences.clear();
+        for (size_t i = 0; i < setting.size(); i++)
+            ctx.preferences[setting[i].first] = setting[i].second;
+        ctx.mode = SimContext::kDisabled;
+        ctx.enabled = false;
+        m_robot->DisabledInit();
+        m_robot->DisabledPeriodic();
+        sim::AdvanceClock(kPacketPeriod);
+
+        m_model->GetParams() = params;
+        m_model->Reset(start, ctx.now, seed);
+        ctx.mode = SimContext::kAutonomous;
+        ctx.enabled = true;
+        double modeStart = ctx.now;
+        double lastMoving = 0.0;
+        double period = m_robot->GetPeriod() > 0.0 ? m_robot->GetPeriod() : kPacketPeriod;
+        m_robot->AutonomousInit();
+        while (ctx.now - modeStart < duration) {
+            double cycleStart = ctx.now;
+            m_robot->AutonomousPeriodic();
+            sim::CheckMotorSafety();
+            double nextPacket = cycleStart + period;
+            if (ctx.now < nextPacket)
+                sim::AdvanceClock(nextPacket - ctx.now);
+            sim::CheckMotorSafety();
+            if (m_model->Speed() > 0.05 || fabs(m_model->TurnRate()) > 5.0)
+                lastMoving = ctx.now - modeStart;
+        }
+
+        RunResult result;
+        result.start = start;
+        result.end = m_model->Pose();
+        result.completeTime = lastMoving;
+        result.contacts = m_model->Contacts();
+        return result;
+    }
+private:
+    SimContext *m_context;
+    IterativeRobot *m_robot;
+    MecanumModel *m_model;
+};
+
+// The run's start pose and model, from nothing but the seed and run number
+void RandomizeRun(const Options &options, int run, FieldPose &start, MecanumModel::Params &params) {
+    std::mt19937 random(options.seed * 1000003u + run);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    params = MecanumModel::Params();
+    start = NominalStart(params);
+    start.x += options.spread * unit(random);
+    start.y += options.spread / 2.0 * unit(random);
+    start.heading += options.turnSpread * unit(random);
+    params.gyroDrift = options.drift * normal(random);
+    params.gyroNoise = options.noise;
+    for (int i = 0; i < RobotDrive::kMaxNumberOfMotors; i++)
+        params.motorScale[i] = 1.0 + options.mismatch * normal(random);
+}
+
+// Where a run should have ended, given where the reference run went
+FieldPose Expected(const RunResult &reference, const FieldPose &start) {
+    double from = reference.start.heading * kPi / 180.0;
+    double dx = reference.end.x - reference.start.x;
+    double dy = reference.end.y - reference.start.y;
+    double right = dx * cos(from) - dy * sin(from);
+    double forward = dx * sin(from) + dy * cos(from);
+    double heading = start.heading * kPi / 180.0;
+    FieldPose expected;
+    expected.x = start.x + right * cos(heading) + forward * sin(heading);
+    expected.y = start.y - right * sin(heading) + forward * cos(heading);
+    expected.heading = start.heading + reference.end.heading - reference.start.heading;
+    return expected;
+}
+
+struct Summary {
+    std::vector<double> values;
+    void Add(double value) {
+        values.push_back(value);
+    }
+    void Print(const char *name) {
+        std::sort(values.begin(), values.end());
+        double sum = 0.0;
+        for (size_t i = 0; i < values.size(); i++)
+            sum += values[i];
+        size_t n = values.size();
+        printf("%-20s %9.3f %9.3f %9.3f %9.3f\n", name, sum / n, values[n / 2],
+               values[std::min(n - 1, (size_t) (n * 0.95))], values[n - 1]);
+    }
+};
+
+void Usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--runs N] [--threads N] [--seed N] [--time S] [--spread M]\n"
+                    "       [--turn-spread DEG] [--drift DEG/S] [--noise DEG] [--mismatch F]\n"
+                    "       [--set KEY=VALUE]... [--sweep KEY=VALUE,VALUE...]...\n", argv0);
+    exit(2);
+}
+
+// Splits KEY=VALUE; false without a key or an '='
+bool SplitAssignment(const char *text, std::string &key, std::string &value) {
+    const char *equals = strchr(text, '=');
+    if (!equals || equals == text)
+        return false;
+    key.assign(text, equals - text);
+    value = equals + 1;
+    return true;
+}
+
+std::vector<std::string> SplitList(const std::string &text) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (true) {
+        size_t comma = text.find(',', start);
+        items.push_back(text.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+        if (comma == std::string::npos)
+            return items;
+        start = comma + 1;
+    }
+}
+
+// Every combination of the sweeps' values, each after the fixed --set ones;
+// the first sweep changes slowest
+std::vector<Setting> Settings(const Options &options) {
+    std::vector<Setting> settings(1, options.sets);
+    for (size_t i = 0; i < options.sweeps.size(); i++) {
+        const std::vector<std::string> &values = options.sweeps[i].second;
+        std::vector<Setting> combined;
+        for (size_t j = 0; j < settings.size(); j++) {
+            for (size_t k = 0; k < values.size(); k++) {
+                combined.push_back(settings[j]);
+                combined.back().push_back(std::make_pair(options.sweeps[i].first, values[k]));
+            }
+        }
+        settings.swap(combined);
+    }
+    return settings;
+}
+
+std::string Describe(const Setting &setting) {
+    if (setting.empty())
+        return "the robot's defaults";
+    std::string text;
+    for (size_t i = 0; i < setting.size(); i++) {
+        if (i > 0)
+            text += " ";
+        text += setting[i].first + "=" + setting[i].second;
+    }
+    return text;
+}
+
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    options.runs = 1000;
+    options.threads = std::thread::hardware_concurrency();
+    options.seed = 1;
+    options.duration = 10.0;
+    options.spread = 0.3;
+    options.turnSpread = 5.0;
+    options.drift = 0.1;
+    options.noise = 0.2;
+    options.mismatch = 0.03;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc)
+            Usage(argv[0]);
+        if (strcmp(argv[i], "--runs") == 0)
+            options.runs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0)
+            options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0)
+            options.seed = strtoul(argv[++i], 0, 10);
+        else if (strcmp(argv[i], "--time") == 0)
+            options.duration = atof(argv[++i]);
+        else if (strcmp(argv[i], "--spread") == 0)
+            options.spread = atof(argv[++i]);
+        else if (strcmp(argv[i], "--turn-spread") == 0)
+            options.turnSpread = atof(argv[++i]);
+        else if (strcmp(argv[i], "--drift") == 0)
+            options.drift = atof(argv[++i]);
+        else if (strcmp(argv[i], "--noise") == 0)
+            options.noise = atof(argv[++i]);
+        else if (strcmp(argv[i], "--mismatch") == 0)
+            options.mismatch = atof(argv[++i]);
+        else if (strcmp(argv[i], "--set") == 0) {
+            std::string key, value;
+            if (!SplitAssignment(argv[++i], key, value))
+                Usage(argv[0]);
+            options.sets.push_back(std::make_pair(key, value));
+        }
+        else if (strcmp(argv[i], "--sweep") == 0) {
+            std::string key, values;
+            if (!SplitAssignment(argv[++i], key, values))
+                Usage(argv[0]);
+            options.sweeps.push_back(std::make_pair(key, SplitList(values)));
+        }
+        else
+            Usage(argv[0]);
+    }
+    if (options.runs < 1)
+        Usage(argv[0]);
+    if (options.threads < 1)
+        options.threads = 1;
+
+    // The robots print to stdout (loop timing dumps); keep that out of the report
+    fflush(stdout);
+    int report = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+
+    std::vector<Setting> settings = Settings(options);
+    int numSettings = settings.size();
+
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    Bench referenceBench;
+    MecanumModel::Params nominal;
+    std::vector<RunResult> references;
+    for (int i = 0; i < numSettings; i++)
+        references.push_back(referenceBench.Run(settings[i], NominalStart(nominal), nominal,
+                                                options.seed, options.duration));
+
+    // job j is run j % runs of setting j / runs
+    std::vector<RunResult> results((size_t) numSettings * options.runs);
+    WorkStealingPool pool(options.threads, results.size());
+    std::vector<std::thread> workers;
+    for (int worker = 0; worker < options.threads; worker++) {
+        workers.push_back(std::thread([&, worker]() {
+            Bench bench;
+            int job;
+            while (pool.Next(worker, job)) {
+                int run = job % options.runs;
+                FieldPose start;
+                MecanumModel::Params params;
+                RandomizeRun(options, run, start, params);
+                results[job] = bench.Run(settings[job / options.runs], start, params,
+                                         options.seed * 1000003u + run, options.duration);
+            }
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    fflush(stdout);
+    dup2(report, 1);
+    close(report);
+
+    printf("autonomous routine of %s\n", argv[0]);
+    printf("%d runs of %.1f s for each of %d settings on %d threads in %.2f s (%.0fx real time)\n",
+           options.runs, options.duration, numSettings, options.threads, wall,
+           numSettings * (options.runs + 1) * options.duration / wall);
+
+    for (int i = 0; i < numSettings; i++) {
+        const RunResult &reference = references[i];
+        double refHeading = reference.start.heading * kPi / 180.0;
+        double refDx = reference.end.x - reference.start.x;
+        double refDy = reference.end.y - reference.start.y;
+        printf("\nsetting: %s\n", Describe(settings[i]).c_str());
+        printf("reference run: %.2f m forward, %.2f m right, turned %.1f deg, done after %.2f s\n",
+               refDx * sin(refHeading) + refDy * cos(refHeading),
+               refDx * cos(refHeading) - refDy * sin(refHeading),
+               reference.end.heading - reference.start.heading, reference.completeTime);
+
+        Summary position, heading, complete;
+        long contactRuns = 0;
+        long contacts = 0;
+        for (int run = 0; run < options.runs; run++) {
+            const RunResult &result = results[(size_t) i * options.runs + run];
+            FieldPose expected = Expected(reference, result.start);
+            position.Add(hypot(result.end.x - expected.x, result.end.y - expected.y) * 100.0);
+            heading.Add(fabs(result.end.heading - expected.heading));
+            complete.Add(result.completeTime);
+            if (result.contacts > 0)
+                contactRuns++;
+            contacts += result.contacts;
+        }
+        printf("%-20s %9s %9s %9s %9s\n", "", "mean", "p50", "p95", "max");
+        position.Print("position error cm");
+        heading.Print("heading error deg");
+        complete.Print("time to complete s");
+        printf("wall contacts: %ld runs (%.1f%%), %ld contacts\n", contactRuns,
+               100.0 * contactRuns / options.runs, contacts);
+    }
+    return 0;
+}
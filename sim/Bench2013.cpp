@@ -0,0 +1,30 @@
+/* What bench2013 measures: the periodic routines and the helpers that run
+ * in them. The robot source is compiled into this file so the helpers can
+ * be called directly.
+ */
+#include "BenchSuite.h"
+#include "../DriveCode.cpp"
+
+namespace {
+
+typedef RobotCase<TM_2013_Robot> Case;
+
+void ReadAxes(TM_2013_Robot *robot) {
+    robot->readAxes();
+}
+void DriveRobot(TM_2013_Robot *robot) {
+    robot->driveRobot(0.3f, -0.5f, 0.1f);
+}
+void FollowProfile(TM_2013_Robot *robot) {
+    robot->followProfile(1.0f);
+}
+
+} // namespace
+
+void AddRobotCases(IterativeRobot *base, std::vector<BenchCase *> &cases) {
+    TM_2013_Robot *robot = static_cast<TM_2013_Robot *>(base);
+    bench::AddPeriodicCases(robot, cases);
+    cases.push_back(new Case("readAxes", robot, SimContext::kTeleop, ReadAxes));
+    cases.push_back(new Case("driveRobot", robot, SimContext::kTeleop, DriveRobot));
+    cases.push_back(new Case("followProfile", robot, SimContext::kAutonomous, FollowProfile));
+}
@@ -0,0 +1,89 @@
+/* What bench2014 measures: the periodic routines and the helpers that run
+ * in them. The robot source is compiled into this file so the helpers can
+ * be called directly.
+ */
+#include "BenchSuite.h"
+#include "../2014Code.cpp"
+
+namespace {
+
+typedef RobotCase<TM_2014_ROBOT> Case;
+
+void ReadInputs(TM_2014_ROBOT *robot) {
+    robot->readInputs();
+}
+void ManagePower(TM_2014_ROBOT *robot) {
+    robot->managePower();
+}
+void IndexLauncherStatus(TM_2014_ROBOT *robot) {
+    robot->indexLauncherStatus();
+}
+void TeleopDrive(TM_2014_ROBOT *robot) {
+    robot->teleopDrive();
+}
+void RunLauncher(TM_2014_ROBOT *robot) {
+    robot->runLauncher();
+}
+void ApplyOutputs(TM_2014_ROBOT *robot) {
+    robot->applyOutputs();
+}
+void RecordCycle(TM_2014_ROBOT *robot) {
+    robot->recordCycle(TelemetryRecord::TELEOP);
+}
+void PublishStatus(TM_2014_ROBOT *robot) {
+    robot->publishStatus();
+}
+// Something for applyOutputs to send
+void ReadInputsAndDrive(TM_2014_ROBOT *robot) {
+    robot->readInputs();
+    robot->teleopDrive();
+}
+// The dashboard task only shows what the loop published
+void ReadInputsAndPublish(TM_2014_ROBOT *robot) {
+    robot->readInputs();
+    robot->publishStatus();
+}
+void DisplayStatusOnDashboard(TM_2014_ROBOT *robot) {
+    robot->displayStatusOnDashboard();
+}
+void UpdateDashboard(TM_2014_ROBOT *robot) {
+    robot->updateDashboard();
+}
+void UpdateNetworkTables(TM_2014_ROBOT *robot) {
+    robot->updateNetworkTables();
+}
+void SendStatus(TM_2014_ROBOT *robot) {
+    robot->sendStatus();
+}
+void ToggleLED(TM_2014_ROBOT *robot) {
+    robot->toggleLED(LED_ON);
+}
+// A change every call, so every call sends
+void PlaceTargetStatus(TM_2014_ROBOT *robot) {
+    static bool detected = false;
+    detected = !detected;
+    robot->placeTargetStatus(detected ? TARGET_DETECTED : TARGET_NOT_DETECTED);
+}
+
+} // namespace
+
+void AddRobotCases(IterativeRobot *base, std::vector<BenchCase *> &cases) {
+    TM_2014_ROBOT *robot = static_cast<TM_2014_ROBOT *>(base);
+    bench::AddPeriodicCases(robot, cases);
+    SimContext::Mode teleop = SimContext::kTeleop;
+    cases.push_back(new Case("readInputs", robot, teleop, ReadInputs));
+    cases.push_back(new Case("managePower", robot, teleop, ManagePower, ReadInputs));
+    cases.push_back(new Case("indexLauncherStatus", robot, teleop, IndexLauncherStatus, ReadInputs));
+    cases.push_back(new Case("teleopDrive", robot, teleop, TeleopDrive, ReadInputs));
+    cases.push_back(new Case("runLauncher", robot, teleop, RunLauncher, ReadInputs));
+    cases.push_back(new Case("applyOutputs", robot, teleop, ApplyOutputs, ReadInputsAndDrive));
+    cases.push_back(new Case("recordCycle", robot, teleop, RecordCycle, ReadInputs));
+    cases.push_back(new Case("publishStatus", robot, teleop, PublishStatus, ReadInputs));
+    cases.push_back(new Case("displayStatusOnDashboard", robot, teleop, DisplayStatusOnDashboard,
+                             ReadInputs));
+    cases.push_back(new Case("updateDashboard", robot, teleop, UpdateDashboard, ReadInputsAndPublish));
+    cases.push_back(new Case("updateNetworkTables", robot, teleop, UpdateNetworkTables));
+    cases.push_back(new Case("sendStatus", robot, teleop, SendStatus, ReadInputsAndPublish));
+    cases.push_back(new Case("toggleLED", robot, teleop, ToggleLED));
+    cases.push_back(new Case("placeTargetStatus", robot, teleop, PlaceTargetStatus));
+}
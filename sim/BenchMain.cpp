@@ -0,0 +1,369 @@
+/* Measures what one call of each periodic routine and the main helpers
+ * costs, in time and in heap churn, against the simulated WPILib.
+ *
+ *   bench2014 [--cycles N] [--warmup N] [--only NAME] [--baseline FILE]
+ *             [--threshold PERCENT] [--no-timing] [--save FILE]
+ *
+ * Each case runs its routine once per cycle with scripted driver inputs on
+ * the virtual clock. Only the routine itself is timed (less the cost of
+ * reading the timer) and has its operator new calls counted; reading the
+ * scripted inputs and moving the clock on happen outside the measurement.
+ * ns/cycle is the median cycle, so a host scheduler hiccup doesn't move it;
+ * the mean is shown as well.
+ *
+ * With --baseline the results are compared with a file written by --save.
+ * A case regresses if it allocates more often or more bytes than it used
+ * to, or if its median is more than the threshold (default 25%) and 25 ns
+ * over the baseline's. The exit status is 1 if anything regressed.
+ * Allocation counts are the same on any machine (though the host's
+ * std::string keeps short strings inline where the cRIO's compiler
+ * allocates every one). Times are only comparable on the machine the
+ * baseline was saved on, and only while it is otherwise idle; on a shared
+ * or noisy host --no-timing still prints them but gates on the allocations
+ * alone.
+ */
+#include "BenchSuite.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+RobotBase *FRC_userClassFactory();
+
+/******************************** Allocations ******************************/
+// GCC sees malloc in operator new and free in operator delete once they are
+// inlined into a caller and takes them for a mismatched pair
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+namespace {
+    // only the benchmark thread's allocations inside run() are counted
+    thread_local bool counting = false;
+    thread_local long allocations = 0;
+    thread_local long allocatedBytes = 0;
+}
+
+void *operator new(size_t size) {
+    if (counting) {
+        allocations++;
+        allocatedBytes += size;
+    }
+    void *block = malloc(size ? size : 1);
+    if (!block)
+        throw std::bad_alloc();
+    return block;
+}
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+void operator delete(void *block) noexcept {
+    free(block);
+}
+void operator delete[](void *block) noexcept {
+    free(block);
+}
+
+namespace {
+
+const double kPacketPeriod = 0.020;
+const double kPi = 3.14159265358979;
+const double kSlackNs = 25.0;       // below this a change is timer noise
+
+struct Options {
+    int cycles;
+    int warmup;
+    const char *only;
+    const char *baseline;
+    double threshold;       // fraction over the baseline median that regresses
+    bool timing;            // whether a slower median regresses at all
+    const char *save;
+};
+
+struct Result {
+    const char *name;
+    double median;          // ns
+    double mean;            // ns
+    double allocs;          // per cycle
+    double bytes;           // per cycle
+};
+
+struct Baseline {
+    char name[64];
+    double median;
+    double allocs;
+    double bytes;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double Nanoseconds(Clock::duration elapsed) {
+    return std::chrono::duration<double, std::nano>(elapsed).count();
+}
+
+// What reading the clock twice costs, taken off every sample
+double TimerOverhead() {
+    std::vector<double> samples(10000);
+    for (size_t i = 0; i < samples.size(); i++) {
+        Clock::time_point start = Clock::now();
+        samples[i] = Nanoseconds(Clock::now() - start);
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+Result Measure(BenchCase &test, const Options &options, double overhead) {
+    test.setup();
+    for (int cycle = 0; cycle < options.warmup; cycle++) {
+        test.prepare(cycle);
+        test.run();
+        test.finish(cycle);
+    }
+    std::vector<double> samples(options.cycles);
+    long allocs = 0;
+    long bytes = 0;
+    double total = 0.0;
+    for (int cycle = 0; cycle < options.cycles; cycle++) {
+        test.prepare(options.warmup + cycle);
+        allocations = 0;
+        allocatedBytes = 0;
+        counting = true;
+        Clock::time_point start = Clock::now();
+        test.run();
+        Clock::time_point end = Clock::now();
+        counting = false;
+        allocs += allocations;
+        bytes += allocatedBytes;
+        double ns = Nanoseconds(end - start) - overhead;
+        samples[cycle] = ns > 0.0 ? ns : 0.0;
+        total += samples[cycle];
+        test.finish(options.warmup + cycle);
+    }
+    std::sort(samples.begin(), samples.end());
+    Result result;
+    result.name = test.name;
+    result.median = samples[samples.size() / 2];
+    result.mean = total / options.cycles;
+    result.allocs = (double) allocs / options.cycles;
+    result.bytes = (double) bytes / options.cycles;
+    return result;
+}
+
+bool LoadBaseline(const char *path, std::vector<Baseline> &entries) {
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return false;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        Baseline entry;
+        if (sscanf(line, "%63s %lf %lf %lf", entry.name, &entry.median, &entry.allocs, &entry.bytes) == 4)
+            entries.push_back(entry);
+    }
+    fclose(file);
+    return true;
+}
+
+bool SaveBaseline(const char *path, const char *program, const std::vector<Result> &results) {
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
+    fprintf(file, "# %s baseline: case, median ns/cycle, allocations/cycle, bytes/cycle\n", program);
+    for (size_t i = 0; i < results.size(); i++)
+        fprintf(file, "%s %.1f %.3f %.1f\n", results[i].name, results[i].median, results[i].allocs,
+                results[i].bytes);
+    fclose(file);
+    return true;
+}
+
+const Baseline *FindBaseline(const std::vector<Baseline> &entries, const char *name) {
+    for (size_t i = 0; i < entries.size(); i++)
+        if (strcmp(entries[i].name, name) == 0)
+            return &entries[i];
+    return 0;
+}
+
+// Why result is worse than base, or 0 if it isn't
+const char *Regression(const Result &result, const Baseline &base, const Options &options) {
+    if (result.allocs > base.allocs + 0.0005)
+        return "more allocations";
+    if (result.bytes > base.bytes * 1.01 + 0.5)
+        return "more bytes";
+    if (options.timing && result.median > base.median * (1.0 + options.threshold)
+        && result.median > base.median + kSlackNs)
+        return "slower";
+    return 0;
+}
+
+void Usage(const char *program) {
+    fprintf(stderr, "usage: %s [--cycles N] [--warmup N] [--only NAME] [--baseline FILE]\n"
+            "       %*s [--threshold PERCENT] [--no-timing] [--save FILE]\n", program,
+            (int) strlen(program), "");
+    exit(2);
+}
+
+} // namespace
+
+/****************************** Scripted inputs ****************************/
+namespace bench {
+    void EnterMode(IterativeRobot *robot, SimContext::Mode mode) {
+        SimContext &ctx = sim::Context();
+        ctx.mode = mode;
+        ctx.enabled = mode != SimContext::kDisabled;
+        if (mode == SimContext::kDisabled)
+            robot->DisabledInit();
+        else if (mode == SimContext::kAutonomous)
+            robot->AutonomousInit();
+        else
+            robot->TeleopInit();
+        NextCycle(robot);
+    }
+    void ScriptInputs(int cycle) {
+        double t = cycle * 0.02;
+        // driving around: forward and back, some strafing and turning
+        sim::SetAxis(1, 2, (float) (0.8 * sin(2.0 * kPi * t / 4.0)));
+        sim::SetAxis(1, 3, (float) (0.5 * sin(2.0 * kPi * t / 3.0)));
+        sim::SetAxis(1, 4, (float) (0.4 * cos(2.0 * kPi * t / 5.0)));
+        // the D-pad left and right now and then
+        int dpad = cycle % 400;
+        sim::SetAxis(1, 6, dpad < 5 ? -1.0f : (dpad >= 200 && dpad < 205) ? 1.0f : 0.0f);
+        // a trigger pull every 6 s, the blocker up and down in between
+        sim::SetButton(2, 1, cycle % 300 < 5);
+        sim::SetButton(2, 3, cycle % 300 >= 100 && cycle % 300 < 105);
+        sim::SetButton(2, 2, cycle % 300 >= 200 && cycle % 300 < 205);
+    }
+    void NextCycle(IterativeRobot *robot) {
+        sim::AdvanceClock(robot->GetPeriod() > 0.0 ? robot->GetPeriod() : kPacketPeriod);
+    }
+
+    void RunDisabled(IterativeRobot *robot) {
+        robot->DisabledPeriodic();
+    }
+    void RunAutonomous(IterativeRobot *robot) {
+        robot->AutonomousPeriodic();
+    }
+    void RunTeleop(IterativeRobot *robot) {
+        robot->TeleopPeriodic();
+    }
+    void AddPeriodicCases(IterativeRobot *robot, std::vector<BenchCase *> &cases) {
+        cases.push_back(new RobotCase<IterativeRobot>("DisabledPeriodic", robot, SimContext::kDisabled,
+                                                      RunDisabled));
+        cases.push_back(new RobotCase<IterativeRobot>("AutonomousPeriodic", robot,
+                                                      SimContext::kAutonomous, RunAutonomous));
+        cases.push_back(new RobotCase<IterativeRobot>("TeleopPeriodic", robot, SimContext::kTeleop,
+                                                      RunTeleop));
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    options.cycles = 5000;
+    options.warmup = 250;
+    options.only = 0;
+    options.baseline = 0;
+    options.threshold = 0.25;
+    options.timing = true;
+    options.save = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-timing") == 0) {
+            options.timing = false;
+            continue;
+        }
+        if (i + 1 >= argc)
+            Usage(argv[0]);
+        if (strcmp(argv[i], "--cycles") == 0)
+            options.cycles = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0)
+            options.warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--only") == 0)
+            options.only = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0)
+            options.baseline = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0)
+            options.threshold = atof(argv[++i]) / 100.0;
+        else if (strcmp(argv[i], "--save") == 0)
+            options.save = argv[++i];
+        else
+            Usage(argv[0]);
+    }
+    if (options.cycles < 1 || options.warmup < 0 || options.threshold < 0.0)
+        Usage(argv[0]);
+    const char *program = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 : argv[0];
+
+    std::vector<Baseline> baseline;
+    if (options.baseline && !LoadBaseline(options.baseline, baseline)) {
+        fprintf(stderr, "cannot read %s\n", options.baseline);
+        return 2;
+    }
+
+    // The robot prints to stdout (loop timing dumps); keep that out of the report
+    fflush(stdout);
+    int report = dup(1);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, 1);
+    close(devNull);
+
+    IterativeRobot *robot = static_cast<IterativeRobot *>(FRC_userClassFactory());
+    robot->RobotInit();
+    bench::NextCycle(robot);
+    std::vector<BenchCase *> cases;
+    AddRobotCases(robot, cases);
+    double overhead = TimerOverhead();
+    std::vector<Result> results;
+    for (size_t i = 0; i < cases.size(); i++)
+        if (!options.only || strcmp(options.only, cases[i]->name) == 0)
+            results.push_back(Measure(*cases[i], options, overhead));
+
+    fflush(stdout);
+    dup2(report, 1);
+    close(report);
+
+    printf("%s: %d cycles per case after %d warm-up, %.0f ns timer overhead taken off\n", program,
+           options.cycles, options.warmup, overhead);
+    printf("%-26s %9s %9s %12s %11s", "case", "ns/cycle", "mean ns", "allocs/cycle", "bytes/cycle");
+    if (options.baseline)
+        printf(" %11s %8s", "baseline ns", "change");
+    printf("\n");
+    int regressions = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &result = results[i];
+        printf("%-26s %9.1f %9.1f %12.3f %11.1f", result.name, result.median, result.mean,
+               result.allocs, result.bytes);
+        if (options.baseline) {
+            const Baseline *base = FindBaseline(baseline, result.name);
+            if (!base) {
+                printf(" %11s", "new");
+            }
+            else {
+                printf(" %11.1f %+7.1f%%", base->median,
+                       base->median > 0.0 ? (result.median / base->median - 1.0) * 100.0 : 0.0);
+                const char *why = Regression(result, *base, options);
+                if (why) {
+                    printf("  REGRESSION: %s (was %.1f ns, %.3f allocs, %.1f bytes)", why, base->median,
+                           base->allocs, base->bytes);
+                    regressions++;
+                }
+            }
+        }
+        printf("\n");
+    }
+    if (options.save) {
+        if (!SaveBaseline(options.save, program, results)) {
+            fprintf(stderr, "cannot write %s\n", options.save);
+            return 2;
+        }
+        printf("baseline saved to %s\n", options.save);
+    }
+    if (regressions) {
+        printf("%d of %d cases regressed against %s\n", regressions, (int) results.size(),
+               options.baseline);
+        return 1;
+    }
+    return 0;
+}
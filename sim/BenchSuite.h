@@ -0,0 +1,72 @@
+/* Pieces shared by the cycle-cost benchmarks (BenchMain.cpp) and the
+ * per-robot files that say what to measure (Bench2014.cpp, Bench2013.cpp).
+ */
+#ifndef BENCH_SUITE_H
+#define BENCH_SUITE_H
+
+#include "SimHooks.h"
+
+#include <vector>
+
+/* One thing to measure. prepare() and finish() run around every cycle but
+ * only run() is timed and has its heap allocations counted.
+ */
+class BenchCase {
+public:
+    explicit BenchCase(const char *name) : name(name) {}
+    virtual ~BenchCase() {}
+    // Once, before the warm-up cycles
+    virtual void setup() {}
+    virtual void prepare(int cycle) {}
+    virtual void run() = 0;
+    virtual void finish(int cycle) {}
+    const char *name;
+};
+
+namespace bench {
+    // Puts the robot in mode and calls the matching Init routine
+    void EnterMode(IterativeRobot *robot, SimContext::Mode mode);
+    // The same scripted driving, trigger pulls and D-pad presses for every
+    // case, so a cycle's inputs depend only on its number
+    void ScriptInputs(int cycle);
+    // Moves the clock on to the next cycle of the robot's loop period
+    void NextCycle(IterativeRobot *robot);
+    void AddPeriodicCases(IterativeRobot *robot, std::vector<BenchCase *> &cases);
+}
+
+/* A routine (usually one of the robot's helpers, through a small function
+ * in the robot's bench file) run once per cycle in a mode, with the
+ * scripted inputs and, if given, the robot's input read before it.
+ */
+template <class T>
+class RobotCase : public BenchCase {
+public:
+    typedef void (*Routine)(T *robot);
+
+    RobotCase(const char *name, T *robot, SimContext::Mode mode, Routine routine, Routine before = 0)
+        : BenchCase(name), robot(robot), mode(mode), routine(routine), before(before) {}
+    virtual void setup() {
+        bench::EnterMode(robot, mode);
+    }
+    virtual void prepare(int cycle) {
+        bench::ScriptInputs(cycle);
+        if (before)
+            before(robot);
+    }
+    virtual void run() {
+        routine(robot);
+    }
+    virtual void finish(int cycle) {
+        bench::NextCycle(robot);
+    }
+private:
+    T *robot;
+    SimContext::Mode mode;
+    Routine routine;
+    Routine before;
+};
+
+// Defined by each robot's bench file
+void AddRobotCases(IterativeRobot *robot, std::vector<BenchCase *> &cases);
+
+#endif
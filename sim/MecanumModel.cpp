@@ -0,0 +1,147 @@
+#include "MecanumModel.h"
+
+#include <math.h>
+
+static const double kPi = 3.14159265358979;
+
+MecanumModel::Params::Params() {
+    maxWheelSpeed = 3.0;
+    timeConstant = 0.1;
+    strafeEfficiency = 0.8;
+    turnRadius = 0.55;
+    halfWidth = 0.38;
+    halfLength = 0.42;
+    fieldWidth = 8.23;      // 27 ft
+    fieldLength = 16.46;    // 54 ft
+    gyroChannel = 1;
+    gyroDrift = 0.0;
+    gyroNoise = 0.0;
+    for (int i = 0; i < RobotDrive::kMaxNumberOfMotors; i++)
+        motorScale[i] = 1.0;
+    encoderChannel[RobotDrive::kFrontLeftMotor] = 3;
+    encoderChannel[RobotDrive::kRearLeftMotor] = 5;
+    encoderChannel[RobotDrive::kFrontRightMotor] = 7;
+    encoderChannel[RobotDrive::kRearRightMotor] = 9;
+    encoderCounts = 4 * 360 / (kPi * 0.1524);   // 360 pulses per turn of a 6" wheel
+    step = 0.001;
+}
+
+MecanumModel::MecanumModel(SpeedController *frontLeft, SpeedController *rearLeft,
+                           SpeedController *frontRight, SpeedController *rearRight, const Params &params)
+    : m_params(params), m_noise(0.0, 1.0) {
+    m_motors[RobotDrive::kFrontLeftMotor] = frontLeft;
+    m_motors[RobotDrive::kRearLeftMotor] = rearLeft;
+    m_motors[RobotDrive::kFrontRightMotor] = frontRight;
+    m_motors[RobotDrive::kRearRightMotor] = rearRight;
+    FieldPose origin = {0.0, 0.0, 0.0};
+    Reset(origin, 0.0);
+}
+
+void MecanumModel::Reset(const FieldPose &start, double now, unsigned seed) {
+    m_random.seed(seed);
+    m_noise.reset();
+    m_pose = start;
+    for (int i = 0; i < RobotDrive::kMaxNumberOfMotors; i++)
+        m_wheelSpeed[i] = 0.0;
+    m_vx = 0.0;
+    m_vy = 0.0;
+    m_omega = 0.0;
+    m_time = now;
+    m_gyroTime = 0.0;
+    m_inContact = false;
+    m_contacts = 0;
+    SimContext &ctx = sim::Context();
+    ctx.gyroAngle[m_params.gyroChannel] = start.heading;
+    ctx.gyroRate[m_params.gyroChannel] = 0.0;
+}
+
+void MecanumModel::Update(double now) {
+    while (m_time + m_params.step <= now) {
+        Step(m_params.step);
+        m_time += m_params.step;
+    }
+}
+
+void MecanumModel::Step(double dt) {
+    // Forward wheel speeds. The right side motors face the other way, so a
+    // positive output rolls those wheels backwards.
+    static const double kMountDirection[RobotDrive::kMaxNumberOfMotors] = {1.0, -1.0, 1.0, -1.0};
+    double lag = dt / m_params.timeConstant;
+    if (lag > 1.0)
+        lag = 1.0;
+    for (int i = 0; i < RobotDrive::kMaxNumberOfMotors; i++) {
+        double output = m_motors[i]->Get();
+        double target = output * kMountDirection[i] * m_params.maxWheelSpeed * m_params.motorScale[i];
+        m_wheelSpeed[i] += (target - m_wheelSpeed[i]) * lag;
+    }
+    double frontLeft = m_wheelSpeed[RobotDrive::kFrontLeftMotor];
+    double frontRight = m_wheelSpeed[RobotDrive::kFrontRightMotor];
+    double rearLeft = m_wheelSpeed[RobotDrive::kRearLeftMotor];
+    double rearRight = m_wheelSpeed[RobotDrive::kRearRightMotor];
+    m_vy = (frontLeft + frontRight + rearLeft + rearRight) / 4.0;
+    m_vx = (frontLeft - frontRight - rearLeft + rearRight) / 4.0 * m_params.strafeEfficiency;
+    m_omega = (frontLeft - frontRight + rearLeft - rearRight) / (4.0 * m_params.turnRadius) * 180.0 / kPi;
+
+    double heading = m_pose.heading * kPi / 180.0;
+    m_pose.x += (m_vx * cos(heading) + m_vy * sin(heading)) * dt;
+    m_pose.y += (-m_vx * sin(heading) + m_vy * cos(heading)) * dt;
+    m_pose.heading += m_omega * dt;
+
+    // Push the robot back inside the walls; hitting one stalls the wheels
+    heading = m_pose.heading * kPi / 180.0;
+    double reachX = fabs(m_params.halfWidth * cos(heading)) + fabs(m_params.halfLength * sin(heading));
+    double reachY = fabs(m_params.halfWidth * sin(heading)) + fabs(m_params.halfLength * cos(heading));
+    bool contact = false;
+    if (m_pose.x < reachX) {
+        m_pose.x = reachX;
+        contact = true;
+    }
+    if (m_pose.x > m_params.fieldWidth - reachX) {
+        m_pose.x = m_params.fieldWidth - reachX;
+        contact = true;
+    }
+    if (m_pose.y < reachY) {
+        m_pose.y = reachY;
+        contact = true;
+    }
+    if (m_pose.y > m_params.fieldLength - reachY) {
+        m_pose.y = m_params.fieldLength - reachY;
+        contact = true;
+    }
+    if (contact) {
+        for (int i = 0; i < RobotDrive::kMaxNumberOfMotors; i++)
+            m_wheelSpeed[i] = 0.0;
+        if (!m_inContact)
+            m_contacts++;
+    }
+    m_inContact = contact;
+
+    m_gyroTime += dt;
+    SimContext &ctx = sim::Context();
+    for (int i = 0; i < RobotDrive::kMaxNumberOfMotors; i++) {
+        int channel = m_params.encoderChannel[i];
+        if (channel <= 0)
+            continue;
+        ctx.encoderRate[channel] = m_wheelSpeed[i] * kMountDirection[i] * m_params.encoderCounts;
+        ctx.encoderCount[channel] += ctx.encoderRate[channel] * dt;
+    }
+    ctx.gyroAngle[m_params.gyroChannel] = m_pose.heading + m_params.gyroDrift * m_gyroTime
+        + m_params.gyroNoise * m_noise(m_random);
+    ctx.gyroRate[m_params.gyroChannel] = m_omega + m_params.gyroDrift;
+}
+
+FieldPose MecanumModel::Pose() const {
+    return m_pose;
+}
+double MecanumModel::Speed() const {
+    return sqrt(m_vx * m_vx + m_vy * m_vy);
+}
+double MecanumModel::TurnRate() const {
+    return m_omega;
+}
+long MecanumModel::Contacts() const {
+    return m_contacts;
+}
+MecanumModel::Params &MecanumModel::GetParams() {
+    return m_params;
+}
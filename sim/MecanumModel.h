@@ -0,0 +1,83 @@
+/* Rigid-body model of a mecanum drive train on the field.
+ *
+ * The model reads the outputs of the robot's four drive motors, so the
+ * inversions in the robot code matter: the right side motors are mounted
+ * mirrored, and a robot that forgets to invert them spins in place. Each wheel's speed follows its motor output with a first-order lag,
+ * and the body velocity comes from the usual mecanum inverse kinematics
+ * (strafing loses some speed to roller slip).
+ *
+ * The field is a rectangle with x across it and y along it, in meters.
+ * Headings are in degrees clockwise from +y, like the gyro. The model writes
+ * the gyro channel with a constant drift and white noise on top of the true
+ * heading.
+ *
+ * Each wheel turns an encoder, counted in the motor's direction like the
+ * outputs, on digital channel encoderChannel[motor] (its A channel; 0 for
+ * none). Both robots wire theirs to the same channels.
+ */
+#ifndef SIM_MECANUM_MODEL_H
+#define SIM_MECANUM_MODEL_H
+
+#include "SimHooks.h"
+
+#include <random>
+
+struct FieldPose {
+    double x;
+    double y;
+    double heading;
+};
+
+class MecanumModel : public SimPhysics {
+public:
+    struct Params {
+        double maxWheelSpeed;       // m/s at full output
+        double timeConstant;        // s for a wheel to reach 63% of a step
+        double strafeEfficiency;    // fraction of the wheel speed a strafe gets
+        double turnRadius;          // m, (wheelbase + track) / 2
+        double halfWidth;           // m, robot frame half sizes
+        double halfLength;
+        double fieldWidth;          // m across the field (x)
+        double fieldLength;         // m along the field (y)
+        int gyroChannel;
+        double gyroDrift;           // deg/s
+        double gyroNoise;           // deg standard deviation per reading
+        double motorScale[RobotDrive::kMaxNumberOfMotors];  // per motor speed mismatch
+        int encoderChannel[RobotDrive::kMaxNumberOfMotors];
+        double encoderCounts;       // 4X edges per meter of wheel travel
+        double step;                // s per integration step
+        Params();
+    };
+
+    MecanumModel(SpeedController *frontLeft, SpeedController *rearLeft, SpeedController *frontRight,
+                 SpeedController *rearRight, const Params &params = Params());
+
+    // Puts the robot at a pose, stopped, with the clock at now. The seed
+    // starts the gyro noise over.
+    void Reset(const FieldPose &start, double now, unsigned seed = 1);
+    virtual void Update(double now);
+
+    FieldPose Pose() const;
+    double Speed() const;           // m/s
+    double TurnRate() const;        // deg/s
+    long Contacts() const;          // times the robot ran into a wall
+
+    Params &GetParams();
+private:
+    void Step(double dt);
+
+    SpeedController *m_motors[RobotDrive::kMaxNumberOfMotors];     // in RobotDrive::MotorType order
+    Params m_params;
+    std::mt19937 m_random;
+    std::normal_distribution<double> m_noise;
+
+    FieldPose m_pose;
+    double m_wheelSpeed[RobotDrive::kMaxNumberOfMotors];
+    double m_vx, m_vy, m_omega;
+    double m_time;
+    double m_gyroTime;
+    bool m_inContact;
+    long m_contacts;
+};
+
+#endif
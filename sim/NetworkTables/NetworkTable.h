@@ -0,0 +1,67 @@
+/* In-process stand-in for the NetworkTables client.
+ *
+ * Tables live in the simulator context, so a Put is visible to every Get in
+ * the same process and listeners are notified synchronously from the writer.
+ */
+#ifndef SIM_NETWORKTABLE_H
+#define SIM_NETWORKTABLE_H
+
+#include <string>
+#include <stdexcept>
+
+class ITable;
+
+typedef union {
+    void *ptr;
+    bool b;
+    double f;
+} EntryValue;
+
+class ITableListener {
+public:
+    virtual ~ITableListener() {}
+    virtual void ValueChanged(ITable *source, const std::string &key, EntryValue value, bool isNew) = 0;
+};
+
+class TableKeyNotDefinedException : public std::runtime_error {
+public:
+    explicit TableKeyNotDefinedException(const std::string &key)
+        : std::runtime_error("Unknown Table Key: " + key) {}
+};
+
+class ITable {
+public:
+    virtual ~ITable() {}
+};
+
+struct SimTable;
+
+class NetworkTable : public ITable {
+public:
+    static NetworkTable *GetTable(std::string key);
+
+    bool ContainsKey(std::string key);
+
+    void PutNumber(std::string key, double value);
+    double GetNumber(std::string key);
+    double GetNumber(std::string key, double defaultValue);
+
+    void PutString(std::string key, std::string value);
+    std::string GetString(std::string key);
+    std::string GetString(std::string key, std::string defaultValue);
+
+    void PutBoolean(std::string key, bool value);
+    bool GetBoolean(std::string key);
+    bool GetBoolean(std::string key, bool defaultValue);
+
+    void AddTableListener(ITableListener *listener);
+    void AddTableListener(ITableListener *listener, bool immediateNotify);
+    void AddTableListener(std::string key, ITableListener *listener, bool immediateNotify);
+    void RemoveTableListener(ITableListener *listener);
+
+    explicit NetworkTable(SimTable *table) : m_table(table) {}
+private:
+    SimTable *m_table;
+};
+
+#endif
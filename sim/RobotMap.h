@@ -0,0 +1,54 @@
+/* Port map used when building the 2014 robot against the simulator.
+ *
+ * The competition RobotMap.h lives on the programming laptop; these values
+ * only need to be distinct and inside the simulator's channel ranges.
+ */
+#ifndef ROBOTMAP_H
+#define ROBOTMAP_H
+
+// Driver station ports
+#define CONTROLLER              1
+#define JOYSTICK                2
+
+// PWM
+#define FRONT_LEFT_WHEEL        1
+#define REAR_LEFT_WHEEL         2
+#define FRONT_RIGHT_WHEEL       3
+#define REAR_RIGHT_WHEEL        4
+
+// Digital I/O
+#define COMPRESSOR_IN           1
+#define LOCKING_MECHANISM_LS    2
+#define FRONT_LEFT_ENCODER_A    3
+#define FRONT_LEFT_ENCODER_B    4
+#define REAR_LEFT_ENCODER_A     5
+#define REAR_LEFT_ENCODER_B     6
+#define FRONT_RIGHT_ENCODER_A   7
+#define FRONT_RIGHT_ENCODER_B   8
+#define REAR_RIGHT_ENCODER_A    9
+#define REAR_RIGHT_ENCODER_B    10
+
+// Relays
+#define COMPRESSOR_OUT          1
+#define CAMERA_LED              2
+
+// Solenoid module
+#define GREEN_FILL              1
+#define GREEN_DROP              2
+#define RED_LOCK                3
+#define RED_LAUNCH              4
+#define BLOCKER_DOWN            5
+#define BLOCKER_UP              6
+
+// Analog
+#define GYRO                    1
+
+// Files (relative to where the simulator is run)
+#ifndef TELEMETRY_LOG
+#define TELEMETRY_LOG           "telemetry.bin"
+#endif
+#ifndef SHOT_REPORT
+#define SHOT_REPORT             "shots.txt"
+#endif
+
+#endif
@@ -0,0 +1,137 @@
+/* Simulator state and the hooks the driver uses to poke at it.
+ *
+ * All of the "hardware" lives in a SimContext. Each thread has its own
+ * current context, so several robots can be stepped side by side without
+ * seeing each other's outputs.
+ */
+#ifndef SIM_HOOKS_H
+#define SIM_HOOKS_H
+
+#include "WPILib.h"
+#include "NetworkTables/NetworkTable.h"
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+struct SimTable {
+    struct Entry {
+        enum Type {kNumber, kString, kBoolean} type;
+        double number;
+        bool boolean;
+        std::string text;
+    };
+    struct Listener {
+        ITableListener *listener;
+        std::string key;     // empty for "every key"
+    };
+    std::map<std::string, Entry> entries;
+    std::vector<Listener> listeners;
+    NetworkTable *table;
+    // Robot tasks use tables too, like the real client library allows
+    std::recursive_mutex lock;
+};
+
+// Something that moves along with the virtual clock, like a model of the
+// drive train. Update() is called whenever the clock moves and before each
+// Notifier handler runs.
+class SimPhysics {
+public:
+    virtual ~SimPhysics() {}
+    virtual void Update(double now) = 0;
+};
+
+struct SimContext {
+    enum Mode {kDisabled, kAutonomous, kTeleop, kTest};
+    static const int kNumJoysticks = 4;
+    static const int kNumAxes = 6;
+    static const int kNumButtons = 12;
+    static const int kNumPWM = 10;
+    static const int kNumDigital = 14;
+    static const int kNumRelays = 8;
+    static const int kNumSolenoids = 8;
+    static const int kNumAnalog = 8;
+    static constexpr double kClockReadCost = 1.0e-6;
+    static constexpr double kBrownoutVoltage = 6.8;
+
+    SimContext();
+    ~SimContext();
+
+    double now;
+    Mode mode;
+    bool enabled;
+
+    float joystickAxes[kNumJoysticks + 1][kNumAxes + 1];
+    bool joystickButtons[kNumJoysticks + 1][kNumButtons + 1];
+
+    float pwm[kNumPWM + 1];
+    double motorLoad;                     // sum of |pwm|, kept by SetPWM()
+    bool digital[kNumDigital + 1];
+    Relay::Value relay[kNumRelays + 1];
+    bool solenoid[kNumSolenoids + 1];
+    double gyroAngle[kNumAnalog + 1];    // true heading, degrees
+    double gyroRate[kNumAnalog + 1];     // degrees per second
+    double gyroZeroVolts[kNumAnalog + 1]; // output at rest; 2.5 V, give or take the part
+    double gyroSensitivity[kNumAnalog + 1]; // volts per degree per second
+    float analogSampleRate;               // conversions per second, all channels together
+    double encoderCount[kNumDigital + 1]; // 4X edges, by A channel
+    double encoderRate[kNumDigital + 1];  // edges per second
+
+    bool compressorEnabled;
+    bool pressureSwitch;                  // true once the tank is full
+    double tankPressure;                  // psi
+    double airTime;                       // when tankPressure was last updated
+    float batteryVoltage;                 // at the terminals, under the present load
+    double batteryOpenVoltage;            // with nothing drawing current
+    double batteryResistance;             // ohms, battery and wiring together
+    float lowestBattery;
+    long brownouts;                       // times the battery fell below kBrownoutVoltage
+    bool brownedOut;
+
+    char lcdBuffer[DriverStationLCD::kNumLines][DriverStationLCD::kLineLength + 1];
+    char lcdDisplay[DriverStationLCD::kNumLines][DriverStationLCD::kLineLength + 1];
+    long lcdUpdates;
+
+    std::map<std::string, SimTable *> tables;
+    std::map<std::string, std::string> preferences;
+
+    std::vector<MotorSafetyHelper *> safetyHelpers;
+    std::vector<Talon *> talons;          // in the order they were made
+    long safetyTimeouts;
+
+    std::vector<Notifier *> notifiers;
+    double nextNotifier;                  // earliest queued expiration
+    bool inNotifier;
+
+    SimPhysics *physics;                  // not owned; 0 when nothing is modelled
+
+    // Tasks run in step with the clock: it stops at each time a waiting
+    // task wakes up until that task is back in Wait()
+    std::mutex taskLock;
+    std::condition_variable taskChanged;
+    int tasksRunning;                     // started or woken, not yet waiting
+    std::multiset<double> taskWakes;      // when the waiting tasks wake up
+};
+
+namespace sim {
+    // The context used by every WPILib call on this thread.
+    SimContext &Context();
+    void SetContext(SimContext *context);
+
+    // Moves the virtual clock forward, running any Notifier handlers that
+    // come due on the way.
+    void AdvanceClock(double seconds);
+
+    // Stops anything with motor safety (a RobotDrive, a Talon) that has not
+    // been fed within its expiration and counts the timeout, like the
+    // MotorSafety helpers would on the cRIO.
+    void CheckMotorSafety();
+
+    void SetAxis(int port, int axis, float value);
+    void SetButton(int port, int button, bool pressed);
+}
+
+#endif
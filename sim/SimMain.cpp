@@ -0,0 +1,361 @@
+/* Runs a robot class through a match on the virtual clock.
+ *
+ *   robot2014 [--disabled S] [--auto S] [--teleop S] [--script FILE] [--battery V]
+ *             [--gyro-bias DEG/S] [--max-cycle MS] [--realtime] [--lcd] [--status]
+ *
+ * Each periodic routine is called on a 20 ms driver station packet period.
+ * The script file scripts driver inputs, one change per line:
+ *
+ *   <mode> <seconds into mode> axis <port> <axis> <value>
+ *   <mode> <seconds into mode> button <port> <button> <0|1>
+ *   <mode> <seconds into mode> digital <channel> 0 <0|1>
+ *   <mode> <seconds into mode> solenoid <channel> 0 <0|1>
+ *
+ * where <mode> is disabled, auto or teleop. A solenoid line checks that the
+ * channel is on (1) or off (0) at that time rather than setting anything. --battery sets the battery's
+ * open-circuit voltage; a tired battery browns out sooner. --gyro-bias
+ * moves the gyro's output at rest away from the nominal 2.5 V by that many
+ * degrees per second, as a part that has never been calibrated would be.
+ * --status decodes the "Robot Status" frames the way a dashboard would see
+ * them, only the last one put in each 100 ms NetworkTables write period,
+ * prints the fields each one carried and counts the ones whose fields don't
+ * match what the robot last put. --max-cycle fails the run if any
+ * periodic call takes longer than that, so a Wait() in the loop shows up.
+ * The exit status is 1 if a check or the cycle limit failed.
+ */
+#include "SimHooks.h"
+#include "StatusPublisher.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+RobotBase *FRC_userClassFactory();
+
+namespace {
+
+const double kPacketPeriod = 0.020;
+
+struct ScriptEvent {
+    SimContext::Mode mode;
+    double time;
+    char kind[16];
+    int port;
+    int index;
+    float value;
+};
+
+struct ModeStats {
+    long cycles;
+    long overLimit;                 // calls longer than --max-cycle
+    double totalVirtual;
+    double maxVirtual;
+    double totalWall;
+    double maxWall;
+    long overruns;
+    long missedPackets;
+};
+
+bool ParseMode(const char *name, SimContext::Mode &mode) {
+    if (strcmp(name, "disabled") == 0)
+        mode = SimContext::kDisabled;
+    else if (strcmp(name, "auto") == 0)
+        mode = SimContext::kAutonomous;
+    else if (strcmp(name, "teleop") == 0)
+        mode = SimContext::kTeleop;
+    else
+        return false;
+    return true;
+}
+
+bool LoadScript(const char *path, std::vector<ScriptEvent> &events) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "cannot open script %s\n", path);
+        return false;
+    }
+    char line[256];
+    int lineNum = 0;
+    while (fgets(line, sizeof(line), file)) {
+        lineNum++;
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        char mode[16];
+        ScriptEvent event;
+        if (sscanf(line, "%15s %lf %15s %d %d %f", mode, &event.time, event.kind,
+                   &event.port, &event.index, &event.value) != 6 || !ParseMode(mode, event.mode)) {
+            fprintf(stderr, "%s:%d: cannot parse \"%s\"\n", path, lineNum, line);
+            fclose(file);
+            return false;
+        }
+        events.push_back(event);
+    }
+    fclose(file);
+    return true;
+}
+
+long checksFailed = 0;
+
+void ApplyScript(const std::vector<ScriptEvent> &events, SimContext::Mode mode, double from, double to) {
+    SimContext &ctx = sim::Context();
+    for (size_t i = 0; i < events.size(); i++) {
+        const ScriptEvent &event = events[i];
+        if (event.mode != mode || event.time < from || event.time >= to)
+            continue;
+        if (strcmp(event.kind, "axis") == 0)
+            sim::SetAxis(event.port, event.index, event.value);
+        else if (strcmp(event.kind, "button") == 0)
+            sim::SetButton(event.port, event.index, event.value != 0.0);
+        else if (strcmp(event.kind, "digital") == 0)
+            ctx.digital[event.port] = event.value != 0.0;
+        else if (strcmp(event.kind, "solenoid") == 0 && ctx.solenoid[event.port] != (event.value != 0.0)) {
+            printf("[%8.3f] check failed: solenoid %d is %s\n", ctx.now, event.port,
+                   ctx.solenoid[event.port] ? "on" : "off");
+            checksFailed++;
+        }
+    }
+}
+
+void RunMode(IterativeRobot *robot, SimContext::Mode mode, double duration,
+             const std::vector<ScriptEvent> &script, double maxCycle, bool realtime, bool showLCD,
+             ModeStats &stats) {
+    SimContext &ctx = sim::Context();
+    ctx.mode = mode;
+    ctx.enabled = mode != SimContext::kDisabled;
+    memset(&stats, 0, sizeof(stats));
+
+    double modeStart = ctx.now;
+    ApplyScript(script, mode, -1.0, 0.0);
+    if (mode == SimContext::kDisabled)
+        robot->DisabledInit();
+    else if (mode == SimContext::kAutonomous)
+        robot->AutonomousInit();
+    else
+        robot->TeleopInit();
+
+    // robots that set a loop period run at it instead of once per packet
+    double period = robot->GetPeriod() > 0.0 ? robot->GetPeriod() : kPacketPeriod;
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    double lastScript = 0.0;
+    while (ctx.now - modeStart < duration) {
+        ApplyScript(script, mode, lastScript, ctx.now - modeStart + 1e-9);
+        lastScript = ctx.now - modeStart + 1e-9;
+
+        double cycleStart = ctx.now;
+        std::chrono::steady_clock::time_point wallCycle = std::chrono::steady_clock::now();
+        if (mode == SimContext::kDisabled)
+            robot->DisabledPeriodic();
+        else if (mode == SimContext::kAutonomous)
+            robot->AutonomousPeriodic();
+        else
+            robot->TeleopPeriodic();
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallCycle).count();
+        double cycle = ctx.now - cycleStart;
+        sim::CheckMotorSafety();
+
+        stats.cycles++;
+        stats.totalVirtual += cycle;
+        stats.totalWall += wall;
+        if (cycle > stats.maxVirtual)
+            stats.maxVirtual = cycle;
+        if (wall > stats.maxWall)
+            stats.maxWall = wall;
+        if (cycle + wall > period) {
+            stats.overruns++;
+            stats.missedPackets += (long) ((cycle + wall) / period);
+        }
+        if (maxCycle > 0.0 && cycle + wall > maxCycle) {
+            printf("[%8.3f] periodic call took %.1f ms\n", ctx.now, (cycle + wall) * 1e3);
+            stats.overLimit++;
+        }
+
+        // Wait for the next driver station packet (or loop period)
+        double nextPacket = cycleStart + period;
+        if (ctx.now < nextPacket)
+            sim::AdvanceClock(nextPacket - ctx.now);
+        sim::CheckMotorSafety();
+
+        if (showLCD && ctx.lcdUpdates > 0) {
+            static char shown[DriverStationLCD::kNumLines][DriverStationLCD::kLineLength + 1];
+            if (memcmp(shown, ctx.lcdDisplay, sizeof(shown)) != 0) {
+                memcpy(shown, ctx.lcdDisplay, sizeof(shown));
+                printf("[%8.3f] LCD\n", ctx.now);
+                for (UINT32 i = 0; i < DriverStationLCD::kNumLines; i++)
+                    printf("           |%s|\n", ctx.lcdDisplay[i]);
+            }
+        }
+        if (realtime) {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - wallStart;
+            double ahead = (ctx.now - modeStart) - elapsed.count();
+            if (ahead > 0.0)
+                std::this_thread::sleep_for(std::chrono::duration<double>(ahead));
+        }
+    }
+}
+
+void PrintStats(const char *name, const ModeStats &stats) {
+    if (stats.cycles == 0)
+        return;
+    printf("%-9s %7ld %11.3f %11.3f %11.1f %11.1f %9ld %9ld\n", name, stats.cycles,
+           stats.totalVirtual / stats.cycles * 1e3, stats.maxVirtual * 1e3,
+           stats.totalWall / stats.cycles * 1e6, stats.maxWall * 1e6,
+           stats.overruns, stats.missedPackets);
+}
+
+// The dashboard end of the robot's status frames. The simulated table calls
+// listeners on every put, but NetworkTables only sends the last value put in
+// each write period, so the viewer holds each frame until the period is over
+// and decodes the last one. A second decoder sees every frame, as the robot
+// put them, to check the dashboard's fields against.
+class StatusViewer : public ITableListener {
+public:
+    static constexpr double kWritePeriod = 0.1;
+
+    StatusViewer() : puts(0), mismatches(0), pendingPeriod(-1) {}
+    void ValueChanged(ITable *source, const std::string &key, EntryValue value, bool isNew) {
+        if (key != "frame")
+            return;
+        long period = (long) (sim::Context().now / kWritePeriod);
+        if (period != pendingPeriod)
+            Deliver();
+        pending = *(std::string *) value.ptr;
+        pendingPeriod = period;
+        puts++;
+        if (robotSide.decode(pending.c_str()))
+            for (int i = 0; i < StatusCodec::kNumFields; i++)
+                expected[i] = robotSide.value(i);
+    }
+    // Decodes the frame held for the last write period, if any
+    void Deliver() {
+        if (pendingPeriod < 0)
+            return;
+        double at = (pendingPeriod + 1) * kWritePeriod;
+        pendingPeriod = -1;
+        if (!decoder.decode(pending.c_str())) {
+            printf("[%8.3f] status: bad frame \"%s\"\n", at, pending.c_str());
+            return;
+        }
+        UINT16 fields = decoder.changed();
+        printf("[%8.3f] status%s%s:", at,
+               fields & StatusCodec::kKeyframe ? " keyframe" : "", decoder.isStale() ? " (stale)" : "");
+        for (int i = 0; i < StatusCodec::kNumFields; i++)
+            if (fields & (1 << i))
+                printf(" %s %g", StatusCodec::info(i).name, decoder.value(i));
+        printf("\n");
+        if (decoder.isStale())
+            return;
+        for (int i = 0; i < StatusCodec::kNumFields; i++) {
+            if (!decoder.isKnown(i) || decoder.value(i) != expected[i]) {
+                printf("[%8.3f] status: %s is %g, the robot put %g\n", at, StatusCodec::info(i).name,
+                       decoder.value(i), expected[i]);
+                mismatches++;
+            }
+        }
+    }
+    StatusDecoder decoder;
+    long puts;
+    long mismatches;
+private:
+    StatusDecoder robotSide;
+    float expected[StatusCodec::kNumFields];
+    std::string pending;
+    long pendingPeriod;
+};
+
+void Usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--disabled S] [--auto S] [--teleop S] [--script FILE] [--battery V]\n"
+                    "       [--gyro-bias DEG/S] [--max-cycle MS] [--realtime] [--lcd] [--status]\n",
+            argv0);
+    exit(2);
+}
+
+}
+
+int main(int argc, char **argv) {
+    double disabledTime = 1.0;
+    double autoTime = 15.0;
+    double teleopTime = 135.0;
+    bool realtime = false;
+    bool showLCD = false;
+    bool showStatus = false;
+    double battery = 0.0;
+    double gyroBias = 0.0;
+    double maxCycle = 0.0;
+    std::vector<ScriptEvent> script;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--disabled") == 0 && i + 1 < argc)
+            disabledTime = atof(argv[++i]);
+        else if (strcmp(argv[i], "--auto") == 0 && i + 1 < argc)
+            autoTime = atof(argv[++i]);
+        else if (strcmp(argv[i], "--teleop") == 0 && i + 1 < argc)
+            teleopTime = atof(argv[++i]);
+        else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            if (!LoadScript(argv[++i], script))
+                return 1;
+        }
+        else if (strcmp(argv[i], "--battery") == 0 && i + 1 < argc)
+            battery = atof(argv[++i]);
+        else if (strcmp(argv[i], "--gyro-bias") == 0 && i + 1 < argc)
+            gyroBias = atof(argv[++i]);
+        else if (strcmp(argv[i], "--max-cycle") == 0 && i + 1 < argc)
+            maxCycle = atof(argv[++i]) / 1e3;
+        else if (strcmp(argv[i], "--realtime") == 0)
+            realtime = true;
+        else if (strcmp(argv[i], "--lcd") == 0)
+            showLCD = true;
+        else if (strcmp(argv[i], "--status") == 0)
+            showStatus = true;
+        else
+            Usage(argv[0]);
+    }
+
+    SimContext &ctx = sim::Context();
+    if (battery > 0.0) {
+        ctx.batteryOpenVoltage = battery;
+        ctx.lowestBattery = battery;
+    }
+    for (int i = 1; i <= SimContext::kNumAnalog; i++)
+        ctx.gyroZeroVolts[i] += gyroBias * ctx.gyroSensitivity[i];
+    StatusViewer statusViewer;
+    if (showStatus)
+        NetworkTable::GetTable("Robot Status")->AddTableListener("frame", &statusViewer, true);
+    IterativeRobot *robot = static_cast<IterativeRobot *>(FRC_userClassFactory());
+    double bootTime = ctx.now;
+    robot->RobotInit();
+
+    ModeStats disabled, autonomous, teleop, postMatch;
+    RunMode(robot, SimContext::kDisabled, disabledTime, script, maxCycle, realtime, showLCD, disabled);
+    RunMode(robot, SimContext::kAutonomous, autoTime, script, maxCycle, realtime, showLCD, autonomous);
+    RunMode(robot, SimContext::kTeleop, teleopTime, script, maxCycle, realtime, showLCD, teleop);
+    RunMode(robot, SimContext::kDisabled, kPacketPeriod, script, maxCycle, realtime, showLCD, postMatch);
+
+    printf("boot to RobotInit: %.3f s (virtual)\n", bootTime);
+    printf("%-9s %7s %11s %11s %11s %11s %9s %9s\n", "mode", "cycles", "mean ms", "max ms",
+           "wall us", "max wall us", "overruns", "missed");
+    PrintStats("disabled", disabled);
+    PrintStats("auto", autonomous);
+    PrintStats("teleop", teleop);
+    printf("motor safety timeouts: %ld\n", ctx.safetyTimeouts);
+    printf("LCD updates: %ld\n", ctx.lcdUpdates);
+    printf("battery: lowest %.2f V, %ld brownouts below %.1f V\n", ctx.lowestBattery, ctx.brownouts,
+           SimContext::kBrownoutVoltage);
+    if (showStatus) {
+        statusViewer.Deliver();
+        printf("status frames: %ld put, %ld decoded, %ld gaps, %ld bad, %ld fields wrong\n",
+               statusViewer.puts, statusViewer.decoder.frameCount(), statusViewer.decoder.gapCount(),
+               statusViewer.decoder.badCount(), statusViewer.mismatches);
+    }
+
+    long overLimit = disabled.overLimit + autonomous.overLimit + teleop.overLimit + postMatch.overLimit;
+    if (maxCycle > 0.0)
+        printf("periodic calls over %.1f ms: %ld\n", maxCycle * 1e3, overLimit);
+    if (checksFailed > 0)
+        printf("script checks failed: %ld\n", checksFailed);
+
+    delete robot;
+    return overLimit > 0 || checksFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+/* Converts a telemetry log written by TelemetryRecorder to CSV.
+ *
+ *   telemetry2csv telemetry.bin > telemetry.csv
+ *
+ * Times are in seconds; solenoid values are the DoubleSolenoid::Value
+ * numbers (0 off, 1 forward, 2 reverse). Gaps in the sequence column are
+ * records the recorder had to drop.
+ */
+#include "TelemetryRecorder.h"
+
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s LOG\n", argv[0]);
+        return 2;
+    }
+    FILE *file = fopen(argv[1], "rb");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+    UINT8 header[TelemetryCodec::kHeaderSize];
+    if (fread(header, sizeof(header), 1, file) != 1 || !TelemetryCodec::decodeHeader(header)) {
+        fprintf(stderr, "%s is not a version %d telemetry log\n", argv[1], TelemetryCodec::kVersion);
+        fclose(file);
+        return 1;
+    }
+
+    printf("sequence,time,mode,launcher_status,autonomous_state,launching");
+    for (int i = 1; i <= RobotSnapshot::kNumAxes; i++)
+        printf(",controller_axis%d", i);
+    for (int i = 1; i <= RobotSnapshot::kNumAxes; i++)
+        printf(",joystick_axis%d", i);
+    printf(",controller_buttons,joystick_buttons,launch_in,lock_in,blocker_in,locking_ls"
+           ",gyro_angle,timer_launch,timer_auto,drive_x,drive_y,drive_rotation"
+           ",launch_out,lock_out,blocker_out,compressor,pressure_switch,tank_psi,launcher_psi"
+           ",battery_volts,drive_limit,compressor_held\n");
+
+    UINT8 bytes[TelemetryCodec::kRecordSize];
+    long records = 0;
+    long missing = 0;
+    UINT32 lastSequence = 0;
+    while (fread(bytes, sizeof(bytes), 1, file) == 1) {
+        TelemetryRecord r;
+        TelemetryCodec::decode(bytes, r);
+        if (records > 0 && r.sequence != lastSequence + 1)
+            missing += r.sequence - lastSequence - 1;
+        lastSequence = r.sequence;
+        records++;
+
+        printf("%u,%.6f,%d,%d,%d,%d", r.sequence, r.time / 1e6, r.mode, r.launcherStatus,
+               r.autonomousState, r.launching);
+        for (int i = 0; i < RobotSnapshot::kNumAxes; i++)
+            printf(",%g", r.controllerAxes[i]);
+        for (int i = 0; i < RobotSnapshot::kNumAxes; i++)
+            printf(",%g", r.joystickAxes[i]);
+        printf(",0x%04x,0x%04x,%d,%d,%d,%d,%g,%g,%g,%g,%g,%g,%d,%d,%d,%d,%d,%.1f,%.1f,%.2f,%.3f,%d\n",
+               r.controllerButtons, r.joystickButtons, r.launchIn, r.lockIn, r.blockerIn,
+               r.lockingLS ? 1 : 0, r.gyroAngle, r.timerLaunch, r.timerAuto,
+               r.driveX, r.driveY, r.driveRotation, r.launchOut, r.lockOut, r.blockerOut,
+               r.compressorEnabled ? 1 : 0, r.pressureSwitch ? 1 : 0, r.tankPressure,
+               r.launcherPressure, r.batteryVoltage, r.driveLimit, r.compressorHeld ? 1 : 0);
+    }
+    fclose(file);
+    fprintf(stderr, "%ld records, %ld dropped\n", records, missing);
+    return 0;
+}
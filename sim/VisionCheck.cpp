@@ -0,0 +1,93 @@
+/* Sends target records through LoopbackTargetSource and checks that they
+ * come out of TargetChannel's mailbox as they went in, and that GyroHistory
+ * gives back the heading at a frame's capture time.
+ *
+ *   visioncheck
+ *
+ * Prints each check that fails; the exit status is 1 if any did.
+ */
+#include "SimHooks.h"
+#include "VisionTarget.h"
+
+#include <math.h>
+#include <stdio.h>
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const char *what) {
+    if (ok)
+        return;
+    printf("failed: %s\n", what);
+    failures++;
+}
+
+void CheckChannel() {
+    NetworkTable *table = NetworkTable::GetTable("Target Status Table");
+    SnapshotMailbox<TargetRecord> mailbox;
+    TargetChannel channel(table, &mailbox);
+    LoopbackTargetSource source(&channel);
+    TargetRecord record;
+    UINT32 seen = 0;
+    Check(!mailbox.readIfNew(record, seen), "nothing in the mailbox before a record is sent");
+
+    sim::AdvanceClock(1.0);
+    double sentAt = Timer::GetFPGATimestamp();
+    source.see(3.5, -1.25, 12.0, 0.1);
+    Check(mailbox.readIfNew(record, seen), "a sent record reaches the mailbox");
+    Check(record.detected, "detected");
+    Check(record.xOffset == 3.5f && record.yOffset == -1.25f, "offsets");
+    Check(record.distance == 12.0f, "distance");
+    Check(fabs(record.captureTime - (sentAt - 0.1)) < 1e-3, "capture time");
+    Check(record.sequence == 1, "sequence number");
+    Check(!mailbox.readIfNew(record, seen), "a record is only new once");
+
+    source.lose();
+    Check(mailbox.readIfNew(record, seen), "a lost target is sent too");
+    Check(!record.detected && record.sequence == 2, "lost target");
+
+    table->PutString(TargetChannel::key(), "not a record");
+    TargetRecord other = record;
+    other.sequence = 3;
+    char text[TargetCodec::kTextSize + 1];
+    TargetCodec::encode(other, text);
+    text[0] = '9';      // another version
+    table->PutString(TargetChannel::key(), text);
+    Check(!mailbox.readIfNew(record, seen), "bad records don't reach the mailbox");
+    Check(channel.recordsReceived() == 2 && channel.recordsRejected() == 2, "received and rejected counts");
+}
+
+void CheckCodec() {
+    TargetRecord sent = {true, -7.125f, 0.5f, 18.75f, 1234.56789012345, 0xdeadbeef};
+    char text[TargetCodec::kTextSize + 1];
+    TargetCodec::encode(sent, text);
+    TargetRecord got;
+    Check(TargetCodec::decode(text, TargetCodec::kTextSize, got), "a record decodes");
+    Check(got.captureTime == sent.captureTime, "capture time, to the bit");
+    Check(got.sequence == sent.sequence && got.xOffset == sent.xOffset && got.yOffset == sent.yOffset
+          && got.distance == sent.distance && got.detected, "every field");
+    Check(!TargetCodec::decode(text, TargetCodec::kTextSize - 2, got), "a short record");
+}
+
+void CheckHistory() {
+    GyroHistory history;
+    float angle;
+    Check(!history.angleAt(0.0, angle), "an empty history knows no heading");
+    // 100 Hz, turning 10 deg/s
+    for (int i = 0; i < 200; i++)
+        history.record(i * 0.01, i * 0.1f);
+    Check(history.angleAt(1.505, angle) && fabs(angle - 15.05f) < 1e-3, "interpolated heading");
+    Check(history.angleAt(5.0, angle) && angle == 19.9f, "newer than the history gets the last reading");
+    Check(!history.angleAt(0.5, angle), "older than the history");
+}
+
+}
+
+int main() {
+    CheckCodec();
+    CheckChannel();
+    CheckHistory();
+    printf("vision checks: %d failed\n", failures);
+    return failures > 0 ? 1 : 0;
+}
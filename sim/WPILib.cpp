@@ -0,0 +1,1083 @@
+#include "SimHooks.h"
+#include "taskLib.h"
+
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+/********************************** Context *********************************/
+SimContext::SimContext() {
+    now = 0.0;
+    mode = kDisabled;
+    enabled = false;
+    memset(joystickAxes, 0, sizeof(joystickAxes));
+    memset(joystickButtons, 0, sizeof(joystickButtons));
+    memset(pwm, 0, sizeof(pwm));
+    motorLoad = 0.0;
+    for (int i = 0; i <= kNumDigital; i++)
+        digital[i] = true;      // inputs float high with nothing plugged in
+    for (int i = 0; i <= kNumRelays; i++)
+        relay[i] = Relay::kOff;
+    memset(solenoid, 0, sizeof(solenoid));
+    memset(gyroAngle, 0, sizeof(gyroAngle));
+    memset(gyroRate, 0, sizeof(gyroRate));
+    for (int i = 0; i <= kNumAnalog; i++) {
+        gyroZeroVolts[i] = 2.5;
+        gyroSensitivity[i] = 0.007;
+    }
+    analogSampleRate = AnalogModule::kDefaultSampleRate;
+    memset(encoderCount, 0, sizeof(encoderCount));
+    memset(encoderRate, 0, sizeof(encoderRate));
+    compressorEnabled = false;
+    pressureSwitch = true;      // charged in the pits before the match
+    tankPressure = 120.0;
+    airTime = 0.0;
+    batteryOpenVoltage = 12.7;
+    batteryResistance = 0.035;
+    batteryVoltage = batteryOpenVoltage;
+    lowestBattery = batteryVoltage;
+    brownouts = 0;
+    brownedOut = false;
+    for (UINT32 i = 0; i < DriverStationLCD::kNumLines; i++) {
+        memset(lcdBuffer[i], ' ', DriverStationLCD::kLineLength);
+        lcdBuffer[i][DriverStationLCD::kLineLength] = '\0';
+    }
+    memcpy(lcdDisplay, lcdBuffer, sizeof(lcdDisplay));
+    lcdUpdates = 0;
+    safetyTimeouts = 0;
+    nextNotifier = 1e30;
+    inNotifier = false;
+    physics = 0;
+    tasksRunning = 0;
+}
+
+SimContext::~SimContext() {
+    for (std::map<std::string, SimTable *>::iterator it = tables.begin(); it != tables.end(); ++it) {
+        delete it->second->table;
+        delete it->second;
+    }
+}
+
+namespace {
+    // never destroyed: detached tasks may still be using it while the
+    // program exits
+    SimContext &defaultContext = *new SimContext();
+    thread_local SimContext *currentContext = 0;
+    thread_local bool inTask = false;
+    // How long the robot thread waits for a task before carrying on without it
+    const std::chrono::milliseconds kTaskTimeout(100);
+
+    // The battery sags by its resistance times the current drawn: the
+    // electronics, each motor in proportion to its output (a loaded CIM
+    // averaged over a match, not its stall current) and the compressor.
+    // Worked out whenever the clock moves, the compressor starts or stops,
+    // or the robot reads the voltage.
+    const double kBaseCurrent = 3.0;        // A
+    const double kMotorCurrent = 40.0;      // A at full output
+    const double kCompressorCurrent = 15.0; // A
+    const double kBrownoutRecovery = 0.5;   // V above kBrownoutVoltage to count another
+
+    void UpdateBattery(SimContext &ctx) {
+        double current = kBaseCurrent + kMotorCurrent * ctx.motorLoad;
+        if (ctx.compressorEnabled && !ctx.pressureSwitch)
+            current += kCompressorCurrent;
+        ctx.batteryVoltage = (float) (ctx.batteryOpenVoltage - ctx.batteryResistance * current);
+        if (ctx.batteryVoltage < ctx.lowestBattery)
+            ctx.lowestBattery = ctx.batteryVoltage;
+        if (!ctx.brownedOut && ctx.batteryVoltage < SimContext::kBrownoutVoltage) {
+            ctx.brownedOut = true;
+            ctx.brownouts++;
+        }
+        else if (ctx.brownedOut && ctx.batteryVoltage > SimContext::kBrownoutVoltage + kBrownoutRecovery) {
+            ctx.brownedOut = false;
+        }
+    }
+    void SetPWM(SimContext &ctx, UINT32 channel, float value) {
+        ctx.motorLoad += fabs(value) - fabs(ctx.pwm[channel]);
+        ctx.pwm[channel] = value;
+    }
+
+    // The compressor fills the tank slower as it gets fuller; the pressure
+    // switch closes at 120 psi and opens again below 95, like the real one
+    const double kCompressorRate = 2.2;     // psi/s into an empty tank
+    const double kCompressorStall = 150.0;
+    const double kSwitchClose = 120.0;
+    const double kSwitchOpen = 95.0;
+    const double kSolenoidCost = 4.0;       // psi per stroke, averaged over the cylinders
+
+    void UpdateAir(SimContext &ctx) {
+        double dt = ctx.now - ctx.airTime;
+        ctx.airTime = ctx.now;
+        if (ctx.compressorEnabled && !ctx.pressureSwitch && dt > 0.0)
+            ctx.tankPressure += kCompressorRate * (1.0 - ctx.tankPressure / kCompressorStall) * dt;
+        bool wasFull = ctx.pressureSwitch;
+        if (ctx.tankPressure >= kSwitchClose)
+            ctx.pressureSwitch = true;
+        else if (ctx.tankPressure < kSwitchOpen)
+            ctx.pressureSwitch = false;
+        if (ctx.pressureSwitch != wasFull)
+            UpdateBattery(ctx);
+    }
+}
+
+// Runs Notifier handlers in expiration order up to a point in virtual time
+struct NotifierQueue {
+    static void Update(SimContext &ctx) {
+        ctx.nextNotifier = 1e30;
+        for (size_t i = 0; i < ctx.notifiers.size(); i++)
+            if (ctx.notifiers[i]->m_queued && ctx.notifiers[i]->m_expirationTime < ctx.nextNotifier)
+                ctx.nextNotifier = ctx.notifiers[i]->m_expirationTime;
+    }
+    static void Run(double until);
+};
+
+namespace {
+    void MoveClock(SimContext &ctx, double until) {
+        NotifierQueue::Run(until);
+        if (ctx.now < until)
+            ctx.now = until;
+        UpdateAir(ctx);
+        UpdateBattery(ctx);
+        if (ctx.physics)
+            ctx.physics->Update(ctx.now);
+    }
+    bool TaskDue(SimContext &ctx) {
+        return !ctx.taskWakes.empty() && *ctx.taskWakes.begin() <= ctx.now;
+    }
+    // Moves the clock to each task wake up before until and lets that task
+    // run. A task that doesn't get back to Wait() in time is left behind.
+    void RunTasks(SimContext &ctx, double until) {
+        std::unique_lock<std::mutex> lock(ctx.taskLock);
+        for (;;) {
+            ctx.taskChanged.wait_for(lock, kTaskTimeout, [&] { return ctx.tasksRunning == 0; });
+            if (ctx.taskWakes.empty() || *ctx.taskWakes.begin() > until)
+                return;
+            double wake = *ctx.taskWakes.begin();
+            lock.unlock();
+            MoveClock(ctx, wake);
+            lock.lock();
+            ctx.taskChanged.notify_all();
+            if (!ctx.taskChanged.wait_for(lock, kTaskTimeout, [&] { return !TaskDue(ctx); }))
+                return;
+        }
+    }
+}
+
+namespace sim {
+    SimContext &Context() {
+        return currentContext ? *currentContext : defaultContext;
+    }
+    void SetContext(SimContext *context) {
+        currentContext = context;
+    }
+    void AdvanceClock(double seconds) {
+        if (seconds <= 0.0)
+            return;
+        SimContext &ctx = Context();
+        double until = ctx.now + seconds;
+        if (!inTask)
+            RunTasks(ctx, until);
+        MoveClock(ctx, until);
+    }
+    void CheckMotorSafety() {
+        SimContext &ctx = Context();
+        for (size_t i = 0; i < ctx.safetyHelpers.size(); i++)
+            if (ctx.safetyHelpers[i]->Check())
+                ctx.safetyTimeouts++;
+    }
+    void SetAxis(int port, int axis, float value) {
+        Context().joystickAxes[port][axis] = value;
+    }
+    void SetButton(int port, int button, bool pressed) {
+        Context().joystickButtons[port][button] = pressed;
+    }
+}
+
+void NotifierQueue::Run(double until) {
+    SimContext &ctx = sim::Context();
+    if (ctx.inNotifier)
+        return;
+    ctx.inNotifier = true;
+    while (ctx.nextNotifier <= until) {
+        Notifier *due = 0;
+        for (size_t i = 0; i < ctx.notifiers.size(); i++) {
+            Notifier *notifier = ctx.notifiers[i];
+            if (notifier->m_queued && (!due || notifier->m_expirationTime < due->m_expirationTime))
+                due = notifier;
+        }
+        if (ctx.now < due->m_expirationTime)
+            ctx.now = due->m_expirationTime;
+        if (due->m_periodic)
+            due->m_expirationTime += due->m_period;
+        else
+            due->m_queued = false;
+        Update(ctx);
+        if (ctx.physics)
+            ctx.physics->Update(ctx.now);
+        due->m_handler(due->m_param);
+    }
+    ctx.inNotifier = false;
+}
+
+/********************************** Time ***********************************/
+void Wait(double seconds) {
+    if (inTask) {
+        // Wakes when the robot's clock gets there, or after that long in real
+        // time if the robot thread has stopped moving it
+        SimContext &ctx = sim::Context();
+        std::unique_lock<std::mutex> lock(ctx.taskLock);
+        double until = ctx.now + seconds;
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(seconds));
+        std::multiset<double>::iterator wake = ctx.taskWakes.insert(until);
+        ctx.tasksRunning--;
+        ctx.taskChanged.notify_all();
+        ctx.taskChanged.wait_until(lock, deadline, [&] { return ctx.now >= until; });
+        ctx.taskWakes.erase(wake);
+        ctx.tasksRunning++;
+        ctx.taskChanged.notify_all();
+        return;
+    }
+    sim::AdvanceClock(seconds);
+}
+double GetClock() {
+    // Every clock read costs a little virtual time, so a loop that spins on a
+    // timer still finishes and shows up as a long cycle.
+    SimContext &ctx = sim::Context();
+    if (inTask)
+        return ctx.now;
+    ctx.now += SimContext::kClockReadCost;
+    if (ctx.nextNotifier <= ctx.now)
+        NotifierQueue::Run(ctx.now);
+    UpdateAir(ctx);
+    if (ctx.physics)
+        ctx.physics->Update(ctx.now);
+    return ctx.now;
+}
+double GetTime() {
+    return GetClock();
+}
+UINT32 GetFPGATime() {
+    return (UINT32) (GetClock() * 1.0e6);
+}
+
+Timer::Timer() : m_startTime(GetClock()), m_accumulatedTime(0.0), m_running(false) {}
+
+double Timer::Get() {
+    if (m_running)
+        return m_accumulatedTime + GetClock() - m_startTime;
+    return m_accumulatedTime;
+}
+void Timer::Reset() {
+    m_accumulatedTime = 0.0;
+    m_startTime = GetClock();
+}
+void Timer::Start() {
+    if (!m_running) {
+        m_startTime = GetClock();
+        m_running = true;
+    }
+}
+void Timer::Stop() {
+    if (m_running) {
+        m_accumulatedTime = Get();
+        m_running = false;
+    }
+}
+bool Timer::HasPeriodPassed(double period) {
+    if (Get() > period) {
+        m_startTime += period;
+        return true;
+    }
+    return false;
+}
+double Timer::GetFPGATimestamp() {
+    return GetClock();
+}
+
+/********************************* Inputs **********************************/
+Joystick::Joystick(UINT32 port) : m_port(port) {}
+
+float Joystick::GetRawAxis(UINT32 axis) {
+    if (m_port > (UINT32) SimContext::kNumJoysticks || axis > (UINT32) SimContext::kNumAxes)
+        return 0.0;
+    return sim::Context().joystickAxes[m_port][axis];
+}
+bool Joystick::GetRawButton(UINT32 button) {
+    if (m_port > (UINT32) SimContext::kNumJoysticks || button > (UINT32) SimContext::kNumButtons)
+        return false;
+    return sim::Context().joystickButtons[m_port][button];
+}
+bool Joystick::GetTrigger() {
+    return GetRawButton(1);
+}
+float Joystick::GetX() {
+    return GetRawAxis(1);
+}
+float Joystick::GetY() {
+    return GetRawAxis(2);
+}
+
+DigitalInput::DigitalInput(UINT32 channel) : m_channel(channel) {}
+
+UINT32 DigitalInput::Get() {
+    return sim::Context().digital[m_channel] ? 1 : 0;
+}
+UINT32 DigitalInput::GetChannel() {
+    return m_channel;
+}
+
+Encoder::Encoder(UINT32 aChannel, UINT32 bChannel, bool reverseDirection, EncodingType encodingType)
+    : m_aChannel(aChannel), m_bChannel(bChannel), m_reverse(reverseDirection),
+      m_encodingType(encodingType), m_offset(0.0), m_distancePerPulse(1.0) {
+    Reset();
+}
+void Encoder::Start() {
+}
+void Encoder::Stop() {
+}
+void Encoder::Reset() {
+    m_offset = sim::Context().encoderCount[m_aChannel];
+}
+// Counts in the decoding's own units: every edge for 4X, every pulse for 1X
+INT32 Encoder::GetRaw() {
+    double edges = sim::Context().encoderCount[m_aChannel] - m_offset;
+    if (m_reverse)
+        edges = -edges;
+    return (INT32) floor(edges * 0.25 / DecodingScale());
+}
+INT32 Encoder::Get() {
+    return (INT32) (GetRaw() * DecodingScale());
+}
+double Encoder::GetDistance() {
+    return GetRaw() * DecodingScale() * m_distancePerPulse;
+}
+double Encoder::GetRate() {
+    double rate = sim::Context().encoderRate[m_aChannel] * 0.25 * m_distancePerPulse;
+    return m_reverse ? -rate : rate;
+}
+void Encoder::SetDistancePerPulse(double distancePerPulse) {
+    m_distancePerPulse = distancePerPulse;
+}
+void Encoder::SetReverseDirection(bool reverseDirection) {
+    m_reverse = reverseDirection;
+}
+// Pulses per count
+double Encoder::DecodingScale() {
+    switch (m_encodingType) {
+    case k1X: return 1.0;
+    case k2X: return 0.5;
+    default:  return 0.25;
+    }
+}
+
+void AnalogModule::SetSampleRate(float samplesPerSecond) {
+    sim::Context().analogSampleRate = samplesPerSecond;
+}
+float AnalogModule::GetSampleRate() {
+    return sim::Context().analogSampleRate;
+}
+
+// A 12-bit conversion over +-10 V
+static const UINT32 kAnalogLSBWeight = 4882812;
+
+AnalogChannel::AnalogChannel(UINT32 channel)
+    : m_channel(channel), m_averageBits(7), m_oversampleBits(0), m_center(0),
+      m_resetTime(0.0), m_resetAngle(0.0) {}
+AnalogModule *AnalogChannel::GetModule() {
+    static AnalogModule module;
+    return &module;
+}
+UINT32 AnalogChannel::GetLSBWeight() {
+    return kAnalogLSBWeight;
+}
+INT32 AnalogChannel::GetOffset() {
+    return 0;
+}
+void AnalogChannel::SetAverageBits(UINT32 bits) {
+    m_averageBits = bits;
+}
+UINT32 AnalogChannel::GetAverageBits() {
+    return m_averageBits;
+}
+void AnalogChannel::SetOversampleBits(UINT32 bits) {
+    m_oversampleBits = bits;
+}
+UINT32 AnalogChannel::GetOversampleBits() {
+    return m_oversampleBits;
+}
+void AnalogChannel::InitAccumulator() {
+    m_center = 0;
+    ResetAccumulator();
+}
+void AnalogChannel::ResetAccumulator() {
+    SimContext &ctx = sim::Context();
+    m_resetTime = ctx.now;
+    m_resetAngle = ctx.gyroAngle[m_channel];
+}
+void AnalogChannel::SetAccumulatorCenter(INT32 center) {
+    m_center = center;
+}
+void AnalogChannel::SetAccumulatorDeadband(INT32 deadband) {
+}
+// Worked out from the heading change rather than sample by sample: each
+// sample adds the channel's averaged, oversampled value less the center, so
+// the rotation adds up to the angle turned whatever the path
+void AnalogChannel::GetAccumulatorOutput(INT64 *value, UINT32 *count) {
+    SimContext &ctx = sim::Context();
+    double samplesPerSecond = ctx.analogSampleRate / (double) (1 << (m_averageBits + m_oversampleBits));
+    double samples = floor((ctx.now - m_resetTime) * samplesPerSecond);
+    double rawPerVolt = (1 << m_oversampleBits) / (kAnalogLSBWeight * 1e-9);
+    double turned = ctx.gyroAngle[m_channel] - m_resetAngle;
+    double total = (turned * ctx.gyroSensitivity[m_channel] * samplesPerSecond
+                    + samples * ctx.gyroZeroVolts[m_channel]) * rawPerVolt - samples * m_center;
+    *value = (INT64) llround(total);
+    *count = (UINT32) samples;
+}
+
+// The real Gyro averages the analog input for this long before it can be used.
+static const double kGyroCalibrationSampleTime = 5.0;
+
+Gyro::Gyro(UINT32 channel) : m_channel(channel), m_offset(0.0) {
+    Wait(kGyroCalibrationSampleTime);
+    Reset();
+}
+float Gyro::GetAngle() {
+    return (float) (sim::Context().gyroAngle[m_channel] - m_offset);
+}
+double Gyro::GetRate() {
+    return sim::Context().gyroRate[m_channel];
+}
+void Gyro::Reset() {
+    m_offset = sim::Context().gyroAngle[m_channel];
+}
+void Gyro::SetSensitivity(float voltsPerDegreePerSecond) {
+}
+
+/********************************* Outputs *********************************/
+// Feeding and checking are the simulator's bookkeeping, not reads of the
+// robot's clock, so they don't cost any virtual time
+MotorSafetyHelper::MotorSafetyHelper(MotorSafety *safeObject)
+    : m_safeObject(safeObject), m_expiration(0.1), m_lastFeed(sim::Context().now), m_enabled(false),
+      m_expired(false) {
+    sim::Context().safetyHelpers.push_back(this);
+}
+MotorSafetyHelper::~MotorSafetyHelper() {
+    std::vector<MotorSafetyHelper *> &helpers = sim::Context().safetyHelpers;
+    for (size_t i = 0; i < helpers.size(); i++) {
+        if (helpers[i] == this) {
+            helpers.erase(helpers.begin() + i);
+            break;
+        }
+    }
+}
+void MotorSafetyHelper::Feed() {
+    m_lastFeed = sim::Context().now;
+    m_expired = false;
+}
+void MotorSafetyHelper::SetExpiration(float expirationTime) {
+    m_expiration = expirationTime;
+}
+float MotorSafetyHelper::GetExpiration() {
+    return m_expiration;
+}
+bool MotorSafetyHelper::IsAlive() {
+    SimContext &ctx = sim::Context();
+    return !m_enabled || !ctx.enabled || ctx.now - m_lastFeed <= m_expiration;
+}
+void MotorSafetyHelper::SetSafetyEnabled(bool enabled) {
+    m_enabled = enabled;
+}
+bool MotorSafetyHelper::IsSafetyEnabled() {
+    return m_enabled;
+}
+bool MotorSafetyHelper::Check() {
+    if (IsAlive() || m_expired)
+        return false;
+    m_expired = true;
+    m_safeObject->StopMotor();
+    return true;
+}
+
+Talon::Talon(UINT32 channel) : m_channel(channel), m_safetyHelper(this) {
+    sim::Context().talons.push_back(this);
+}
+Talon::~Talon() {
+    std::vector<Talon *> &talons = sim::Context().talons;
+    for (size_t i = 0; i < talons.size(); i++) {
+        if (talons[i] == this) {
+            talons.erase(talons.begin() + i);
+            break;
+        }
+    }
+}
+void Talon::Set(float value, UINT8 syncGroup) {
+    if (value > 1.0)
+        value = 1.0;
+    if (value < -1.0)
+        value = -1.0;
+    SetPWM(sim::Context(), m_channel, value);
+    m_safetyHelper.Feed();
+}
+float Talon::Get() {
+    return sim::Context().pwm[m_channel];
+}
+void Talon::Disable() {
+    SetPWM(sim::Context(), m_channel, 0.0);
+}
+UINT32 Talon::GetChannel() {
+    return m_channel;
+}
+void Talon::SetExpiration(float timeout) {
+    m_safetyHelper.SetExpiration(timeout);
+}
+float Talon::GetExpiration() {
+    return m_safetyHelper.GetExpiration();
+}
+bool Talon::IsAlive() {
+    return m_safetyHelper.IsAlive();
+}
+void Talon::StopMotor() {
+    Disable();
+}
+void Talon::SetSafetyEnabled(bool enabled) {
+    m_safetyHelper.SetSafetyEnabled(enabled);
+}
+bool Talon::IsSafetyEnabled() {
+    return m_safetyHelper.IsSafetyEnabled();
+}
+
+RobotDrive::RobotDrive(SpeedController *frontLeftMotor, SpeedController *rearLeftMotor,
+                       SpeedController *frontRightMotor, SpeedController *rearRightMotor)
+    : m_frontLeftMotor(frontLeftMotor), m_frontRightMotor(frontRightMotor),
+      m_rearLeftMotor(rearLeftMotor), m_rearRightMotor(rearRightMotor),
+      m_maxOutput(1.0), m_safetyHelper(this) {
+    for (int i = 0; i < kMaxNumberOfMotors; i++)
+        m_invertedMotors[i] = 1;
+    m_safetyHelper.SetSafetyEnabled(true);
+}
+RobotDrive::~RobotDrive() {}
+
+static float Limit(float value) {
+    if (value > 1.0)
+        return 1.0;
+    if (value < -1.0)
+        return -1.0;
+    return value;
+}
+
+void RobotDrive::TankDrive(float leftValue, float rightValue, bool squaredInputs) {
+    leftValue = Limit(leftValue);
+    rightValue = Limit(rightValue);
+    if (squaredInputs) {
+        leftValue = leftValue >= 0.0 ? leftValue * leftValue : -(leftValue * leftValue);
+        rightValue = rightValue >= 0.0 ? rightValue * rightValue : -(rightValue * rightValue);
+    }
+    SetLeftRightMotorOutputs(leftValue, rightValue);
+}
+
+void RobotDrive::MecanumDrive_Cartesian(float x, float y, float rotation, float gyroAngle) {
+    double xIn = x;
+    double yIn = -y;    // negate y for the joystick, like WPILib does
+    double cosA = cos(gyroAngle * (3.14159 / 180.0));
+    double sinA = sin(gyroAngle * (3.14159 / 180.0));
+    double xOut = xIn * cosA - yIn * sinA;
+    double yOut = xIn * sinA + yIn * cosA;
+
+    double wheelSpeeds[kMaxNumberOfMotors];
+    wheelSpeeds[kFrontLeftMotor] = xOut + yOut + rotation;
+    wheelSpeeds[kFrontRightMotor] = -xOut + yOut - rotation;
+    wheelSpeeds[kRearLeftMotor] = -xOut + yOut + rotation;
+    wheelSpeeds[kRearRightMotor] = xOut + yOut - rotation;
+
+    double maxMagnitude = 0.0;
+    for (int i = 0; i < kMaxNumberOfMotors; i++)
+        if (fabs(wheelSpeeds[i]) > maxMagnitude)
+            maxMagnitude = fabs(wheelSpeeds[i]);
+    if (maxMagnitude > 1.0)
+        for (int i = 0; i < kMaxNumberOfMotors; i++)
+            wheelSpeeds[i] /= maxMagnitude;
+
+    m_frontLeftMotor->Set(wheelSpeeds[kFrontLeftMotor] * m_invertedMotors[kFrontLeftMotor] * m_maxOutput);
+    m_frontRightMotor->Set(wheelSpeeds[kFrontRightMotor] * m_invertedMotors[kFrontRightMotor] * m_maxOutput);
+    m_rearLeftMotor->Set(wheelSpeeds[kRearLeftMotor] * m_invertedMotors[kRearLeftMotor] * m_maxOutput);
+    m_rearRightMotor->Set(wheelSpeeds[kRearRightMotor] * m_invertedMotors[kRearRightMotor] * m_maxOutput);
+    m_safetyHelper.Feed();
+}
+
+void RobotDrive::SetLeftRightMotorOutputs(float leftOutput, float rightOutput) {
+    m_frontLeftMotor->Set(Limit(leftOutput) * m_invertedMotors[kFrontLeftMotor] * m_maxOutput);
+    m_rearLeftMotor->Set(Limit(leftOutput) * m_invertedMotors[kRearLeftMotor] * m_maxOutput);
+    m_frontRightMotor->Set(-Limit(rightOutput) * m_invertedMotors[kFrontRightMotor] * m_maxOutput);
+    m_rearRightMotor->Set(-Limit(rightOutput) * m_invertedMotors[kRearRightMotor] * m_maxOutput);
+    m_safetyHelper.Feed();
+}
+
+void RobotDrive::SetInvertedMotor(MotorType motor, bool isInverted) {
+    m_invertedMotors[motor] = isInverted ? -1 : 1;
+}
+void RobotDrive::SetMaxOutput(double maxOutput) {
+    m_maxOutput = maxOutput;
+}
+void RobotDrive::StopMotor() {
+    m_frontLeftMotor->Disable();
+    m_frontRightMotor->Disable();
+    m_rearLeftMotor->Disable();
+    m_rearRightMotor->Disable();
+}
+void RobotDrive::SetExpiration(float timeout) {
+    m_safetyHelper.SetExpiration(timeout);
+}
+float RobotDrive::GetExpiration() {
+    return m_safetyHelper.GetExpiration();
+}
+bool RobotDrive::IsAlive() {
+    return m_safetyHelper.IsAlive();
+}
+void RobotDrive::SetSafetyEnabled(bool enabled) {
+    m_safetyHelper.SetSafetyEnabled(enabled);
+}
+bool RobotDrive::IsSafetyEnabled() {
+    return m_safetyHelper.IsSafetyEnabled();
+}
+
+DoubleSolenoid::DoubleSolenoid(UINT32 forwardChannel, UINT32 reverseChannel)
+    : m_forwardChannel(forwardChannel), m_reverseChannel(reverseChannel) {}
+
+void DoubleSolenoid::Set(Value value) {
+    SimContext &ctx = sim::Context();
+    if (value != kOff && value != Get()) {
+        UpdateAir(ctx);
+        ctx.tankPressure -= kSolenoidCost;
+        if (ctx.tankPressure < 0.0)
+            ctx.tankPressure = 0.0;
+    }
+    ctx.solenoid[m_forwardChannel] = value == kForward;
+    ctx.solenoid[m_reverseChannel] = value == kReverse;
+}
+DoubleSolenoid::Value DoubleSolenoid::Get() {
+    SimContext &ctx = sim::Context();
+    if (ctx.solenoid[m_forwardChannel])
+        return kForward;
+    if (ctx.solenoid[m_reverseChannel])
+        return kReverse;
+    return kOff;
+}
+
+Relay::Relay(UINT32 channel, Direction direction) : m_channel(channel) {}
+
+void Relay::Set(Value value) {
+    sim::Context().relay[m_channel] = value;
+}
+Relay::Value Relay::Get() {
+    return sim::Context().relay[m_channel];
+}
+
+Compressor::Compressor(UINT32 pressureSwitchChannel, UINT32 compressorRelayChannel)
+    : m_pressureSwitchChannel(pressureSwitchChannel), m_relayChannel(compressorRelayChannel) {}
+
+void Compressor::Start() {
+    SimContext &ctx = sim::Context();
+    UpdateAir(ctx);
+    ctx.compressorEnabled = true;
+    UpdateBattery(ctx);
+}
+void Compressor::Stop() {
+    SimContext &ctx = sim::Context();
+    UpdateAir(ctx);
+    ctx.compressorEnabled = false;
+    UpdateBattery(ctx);
+}
+bool Compressor::Enabled() {
+    return sim::Context().compressorEnabled;
+}
+UINT32 Compressor::GetPressureSwitchValue() {
+    return sim::Context().pressureSwitch ? 1 : 0;
+}
+
+Notifier::Notifier(TimerEventHandler handler, void *param)
+    : m_handler(handler), m_param(param), m_expirationTime(0.0), m_period(0.0),
+      m_periodic(false), m_queued(false) {
+    sim::Context().notifiers.push_back(this);
+}
+Notifier::~Notifier() {
+    SimContext &ctx = sim::Context();
+    for (size_t i = 0; i < ctx.notifiers.size(); i++) {
+        if (ctx.notifiers[i] == this) {
+            ctx.notifiers.erase(ctx.notifiers.begin() + i);
+            break;
+        }
+    }
+    NotifierQueue::Update(ctx);
+}
+void Notifier::StartSingle(double delay) {
+    m_periodic = false;
+    m_period = delay;
+    m_expirationTime = sim::Context().now + delay;
+    m_queued = true;
+    NotifierQueue::Update(sim::Context());
+}
+void Notifier::StartPeriodic(double period) {
+    m_periodic = true;
+    m_period = period;
+    m_expirationTime = sim::Context().now + period;
+    m_queued = true;
+    NotifierQueue::Update(sim::Context());
+}
+void Notifier::Stop() {
+    m_queued = false;
+    NotifierQueue::Update(sim::Context());
+}
+
+/********************************** Tasks **********************************/
+int taskIdSelf() {
+    static std::atomic<int> nextId(1);
+    thread_local int id = 0;
+    if (id == 0)
+        id = nextId++;
+    return id;
+}
+
+Task::Task(const char *name, FUNCPTR function, INT32 priority, UINT32 stackSize)
+    : m_name(name), m_function(function), m_priority(priority), m_thread(0) {}
+Task::~Task() {
+    Stop();
+}
+bool Task::Start(size_t arg0, size_t arg1, size_t arg2, size_t arg3) {
+    if (m_thread)
+        return false;
+    SimContext *context = &sim::Context();
+    FUNCPTR function = m_function;
+    {
+        std::lock_guard<std::mutex> guard(context->taskLock);
+        context->tasksRunning++;
+    }
+    m_thread = new std::thread([=]() {
+        sim::SetContext(context);
+        inTask = true;
+        function(arg0, arg1, arg2, arg3);
+        std::lock_guard<std::mutex> guard(context->taskLock);
+        context->tasksRunning--;
+        context->taskChanged.notify_all();
+    });
+    return true;
+}
+bool Task::Stop() {
+    if (!m_thread)
+        return false;
+    std::thread *thread = (std::thread *) m_thread;
+    thread->detach();
+    delete thread;
+    m_thread = 0;
+    return true;
+}
+const char *Task::GetName() {
+    return m_name.c_str();
+}
+INT32 Task::GetPriority() {
+    return m_priority;
+}
+
+/****************************** Synchronization ****************************/
+ReentrantSemaphore::ReentrantSemaphore() : m_mutex(new std::recursive_mutex()) {}
+
+ReentrantSemaphore::~ReentrantSemaphore() {
+    delete static_cast<std::recursive_mutex *>(m_mutex);
+}
+int ReentrantSemaphore::take() {
+    static_cast<std::recursive_mutex *>(m_mutex)->lock();
+    return 0;
+}
+int ReentrantSemaphore::give() {
+    static_cast<std::recursive_mutex *>(m_mutex)->unlock();
+    return 0;
+}
+
+/****************************** Driver Station *****************************/
+DriverStation *DriverStation::GetInstance() {
+    static DriverStation instance;
+    return &instance;
+}
+float DriverStation::GetStickAxis(UINT32 stick, UINT32 axis) {
+    if (stick < 1 || stick > kJoystickPorts || axis < 1 || axis > (UINT32) SimContext::kNumAxes)
+        return 0.0;
+    return sim::Context().joystickAxes[stick][axis];
+}
+short DriverStation::GetStickButtons(UINT32 stick) {
+    if (stick < 1 || stick > kJoystickPorts)
+        return 0;
+    short buttons = 0;
+    for (int i = 1; i <= SimContext::kNumButtons; i++)
+        if (sim::Context().joystickButtons[stick][i])
+            buttons |= 1 << (i - 1);
+    return buttons;
+}
+float DriverStation::GetBatteryVoltage() {
+    SimContext &ctx = sim::Context();
+    UpdateBattery(ctx);
+    return ctx.batteryVoltage;
+}
+bool DriverStation::IsEnabled() {
+    return sim::Context().enabled;
+}
+bool DriverStation::IsDisabled() {
+    return !sim::Context().enabled;
+}
+bool DriverStation::IsAutonomous() {
+    return sim::Context().mode == SimContext::kAutonomous;
+}
+bool DriverStation::IsOperatorControl() {
+    return sim::Context().mode == SimContext::kTeleop;
+}
+
+DriverStationLCD *DriverStationLCD::GetInstance() {
+    // All of the LCD state lives in the context, so one instance serves every thread.
+    static DriverStationLCD instance;
+    return &instance;
+}
+
+void DriverStationLCD::UpdateLCD() {
+    SimContext &ctx = sim::Context();
+    memcpy(ctx.lcdDisplay, ctx.lcdBuffer, sizeof(ctx.lcdDisplay));
+    ctx.lcdUpdates++;
+}
+
+void DriverStationLCD::Printf(Line line, INT32 startingColumn, const char *writeFmt, ...) {
+    if ((UINT32) line >= kNumLines || startingColumn < 1 || (UINT32) startingColumn > kLineLength)
+        return;
+    char text[kLineLength + 1];
+    va_list args;
+    va_start(args, writeFmt);
+    vsnprintf(text, sizeof(text), writeFmt, args);
+    va_end(args);
+    char *dest = sim::Context().lcdBuffer[line];
+    for (UINT32 i = 0; text[i] != '\0' && startingColumn - 1 + i < kLineLength; i++)
+        dest[startingColumn - 1 + i] = text[i];
+}
+
+void DriverStationLCD::PrintfLine(Line line, const char *writeFmt, ...) {
+    if ((UINT32) line >= kNumLines)
+        return;
+    char text[kLineLength + 1];
+    va_list args;
+    va_start(args, writeFmt);
+    vsnprintf(text, sizeof(text), writeFmt, args);
+    va_end(args);
+    char *dest = sim::Context().lcdBuffer[line];
+    memset(dest, ' ', kLineLength);
+    memcpy(dest, text, strlen(text));
+}
+
+void DriverStationLCD::Clear() {
+    SimContext &ctx = sim::Context();
+    for (UINT32 i = 0; i < kNumLines; i++)
+        memset(ctx.lcdBuffer[i], ' ', kLineLength);
+}
+
+/******************************** Preferences ******************************/
+Preferences *Preferences::GetInstance() {
+    // The settings live in the context, so one instance serves every thread.
+    static Preferences instance;
+    return &instance;
+}
+std::string Preferences::GetString(const char *key, const char *defaultValue) {
+    std::map<std::string, std::string> &preferences = sim::Context().preferences;
+    std::map<std::string, std::string>::iterator it = preferences.find(key);
+    return it != preferences.end() ? it->second : std::string(defaultValue);
+}
+int Preferences::GetInt(const char *key, int defaultValue) {
+    return ContainsKey(key) ? atoi(GetString(key).c_str()) : defaultValue;
+}
+double Preferences::GetDouble(const char *key, double defaultValue) {
+    return ContainsKey(key) ? atof(GetString(key).c_str()) : defaultValue;
+}
+float Preferences::GetFloat(const char *key, float defaultValue) {
+    return (float) GetDouble(key, defaultValue);
+}
+bool Preferences::GetBoolean(const char *key, bool defaultValue) {
+    return ContainsKey(key) ? GetString(key) == "true" : defaultValue;
+}
+void Preferences::PutString(const char *key, const char *value) {
+    sim::Context().preferences[key] = value;
+}
+void Preferences::PutDouble(const char *key, double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.17g", value);
+    PutString(key, text);
+}
+bool Preferences::ContainsKey(const char *key) {
+    return sim::Context().preferences.count(key) > 0;
+}
+void Preferences::Remove(const char *key) {
+    sim::Context().preferences.erase(key);
+}
+void Preferences::Save() {
+}
+
+/***************************** Robot framework *****************************/
+bool RobotBase::IsEnabled() {
+    return sim::Context().enabled;
+}
+bool RobotBase::IsDisabled() {
+    return !sim::Context().enabled;
+}
+bool RobotBase::IsAutonomous() {
+    return sim::Context().mode == SimContext::kAutonomous;
+}
+bool RobotBase::IsOperatorControl() {
+    return sim::Context().mode == SimContext::kTeleop;
+}
+bool RobotBase::IsTest() {
+    return sim::Context().mode == SimContext::kTest;
+}
+
+/****************************** NetworkTables ******************************/
+NetworkTable *NetworkTable::GetTable(std::string key) {
+    SimContext &ctx = sim::Context();
+    std::map<std::string, SimTable *>::iterator it = ctx.tables.find(key);
+    if (it != ctx.tables.end())
+        return it->second->table;
+    SimTable *simTable = new SimTable();
+    simTable->table = new NetworkTable(simTable);
+    ctx.tables[key] = simTable;
+    return simTable->table;
+}
+
+bool NetworkTable::ContainsKey(std::string key) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    return m_table->entries.count(key) != 0;
+}
+
+static EntryValue ValueOf(SimTable::Entry &entry) {
+    EntryValue value;
+    if (entry.type == SimTable::Entry::kNumber)
+        value.f = entry.number;
+    else if (entry.type == SimTable::Entry::kBoolean)
+        value.b = entry.boolean;
+    else
+        value.ptr = &entry.text;
+    return value;
+}
+
+static void NotifyListeners(NetworkTable *table, SimTable *simTable, const std::string &key,
+                            SimTable::Entry &entry, bool isNew) {
+    EntryValue value = ValueOf(entry);
+    for (size_t i = 0; i < simTable->listeners.size(); i++) {
+        SimTable::Listener &listener = simTable->listeners[i];
+        if (listener.key.empty() || listener.key == key)
+            listener.listener->ValueChanged(table, key, value, isNew);
+    }
+}
+
+void NetworkTable::PutNumber(std::string key, double value) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    bool isNew = !ContainsKey(key);
+    SimTable::Entry &entry = m_table->entries[key];
+    if (!isNew && entry.type == SimTable::Entry::kNumber && entry.number == value)
+        return;
+    entry.type = SimTable::Entry::kNumber;
+    entry.number = value;
+    NotifyListeners(this, m_table, key, entry, isNew);
+}
+double NetworkTable::GetNumber(std::string key) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    std::map<std::string, SimTable::Entry>::iterator it = m_table->entries.find(key);
+    if (it == m_table->entries.end() || it->second.type != SimTable::Entry::kNumber)
+        throw TableKeyNotDefinedException(key);
+    return it->second.number;
+}
+double NetworkTable::GetNumber(std::string key, double defaultValue) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    std::map<std::string, SimTable::Entry>::iterator it = m_table->entries.find(key);
+    if (it == m_table->entries.end() || it->second.type != SimTable::Entry::kNumber)
+        return defaultValue;
+    return it->second.number;
+}
+
+void NetworkTable::PutString(std::string key, std::string value) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    bool isNew = !ContainsKey(key);
+    SimTable::Entry &entry = m_table->entries[key];
+    if (!isNew && entry.type == SimTable::Entry::kString && entry.text == value)
+        return;
+    entry.type = SimTable::Entry::kString;
+    entry.text = value;
+    NotifyListeners(this, m_table, key, entry, isNew);
+}
+std::string NetworkTable::GetString(std::string key) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    std::map<std::string, SimTable::Entry>::iterator it = m_table->entries.find(key);
+    if (it == m_table->entries.end() || it->second.type != SimTable::Entry::kString)
+        throw TableKeyNotDefinedException(key);
+    return it->second.text;
+}
+std::string NetworkTable::GetString(std::string key, std::string defaultValue) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    std::map<std::string, SimTable::Entry>::iterator it = m_table->entries.find(key);
+    if (it == m_table->entries.end() || it->second.type != SimTable::Entry::kString)
+        return defaultValue;
+    return it->second.text;
+}
+
+void NetworkTable::PutBoolean(std::string key, bool value) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    bool isNew = !ContainsKey(key);
+    SimTable::Entry &entry = m_table->entries[key];
+    if (!isNew && entry.type == SimTable::Entry::kBoolean && entry.boolean == value)
+        return;
+    entry.type = SimTable::Entry::kBoolean;
+    entry.boolean = value;
+    NotifyListeners(this, m_table, key, entry, isNew);
+}
+bool NetworkTable::GetBoolean(std::string key) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    std::map<std::string, SimTable::Entry>::iterator it = m_table->entries.find(key);
+    if (it == m_table->entries.end() || it->second.type != SimTable::Entry::kBoolean)
+        throw TableKeyNotDefinedException(key);
+    return it->second.boolean;
+}
+bool NetworkTable::GetBoolean(std::string key, bool defaultValue) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    std::map<std::string, SimTable::Entry>::iterator it = m_table->entries.find(key);
+    if (it == m_table->entries.end() || it->second.type != SimTable::Entry::kBoolean)
+        return defaultValue;
+    return it->second.boolean;
+}
+
+void NetworkTable::AddTableListener(ITableListener *listener) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    AddTableListener(listener, false);
+}
+void NetworkTable::AddTableListener(ITableListener *listener, bool immediateNotify) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    SimTable::Listener entry = {listener, std::string()};
+    m_table->listeners.push_back(entry);
+    if (immediateNotify)
+        for (std::map<std::string, SimTable::Entry>::iterator it = m_table->entries.begin();
+             it != m_table->entries.end(); ++it)
+            listener->ValueChanged(this, it->first, ValueOf(it->second), true);
+}
+void NetworkTable::AddTableListener(std::string key, ITableListener *listener, bool immediateNotify) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    SimTable::Listener entry = {listener, key};
+    m_table->listeners.push_back(entry);
+    std::map<std::string, SimTable::Entry>::iterator it = m_table->entries.find(key);
+    if (immediateNotify && it != m_table->entries.end())
+        listener->ValueChanged(this, key, ValueOf(it->second), true);
+}
+void NetworkTable::RemoveTableListener(ITableListener *listener) {
+    std::lock_guard<std::recursive_mutex> guard(m_table->lock);
+    for (size_t i = 0; i < m_table->listeners.size(); ) {
+        if (m_table->listeners[i].listener == listener)
+            m_table->listeners.erase(m_table->listeners.begin() + i);
+        else
+            i++;
+    }
+}
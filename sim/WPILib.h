@@ -0,0 +1,453 @@
+/* Host-side stand-in for the parts of WPILib the robot code uses.
+ *
+ * Everything here runs against a virtual clock instead of the FPGA, so the
+ * robot classes can be built and stepped on a workstation without a cRIO,
+ * a driver station or a network. Wait() advances the virtual clock instead
+ * of sleeping, which makes blocking code show up as long cycles.
+ */
+#ifndef SIM_WPILIB_H
+#define SIM_WPILIB_H
+
+#include <stdint.h>
+#include <string>
+
+// The cRIO headers leave std::string visible in the global namespace.
+using std::string;
+
+typedef int8_t   INT8;
+typedef uint8_t  UINT8;
+typedef int16_t  INT16;
+typedef uint16_t UINT16;
+typedef int32_t  INT32;
+typedef uint32_t UINT32;
+typedef int64_t  INT64;
+typedef uint64_t UINT64;
+
+/********************************** Time ***********************************/
+void Wait(double seconds);
+double GetClock();
+double GetTime();
+UINT32 GetFPGATime();
+
+class Timer {
+public:
+    Timer();
+    double Get();
+    void Reset();
+    void Start();
+    void Stop();
+    bool HasPeriodPassed(double period);
+    static double GetFPGATimestamp();
+private:
+    double m_startTime;
+    double m_accumulatedTime;
+    bool m_running;
+};
+
+/********************************* Inputs **********************************/
+class Joystick {
+public:
+    explicit Joystick(UINT32 port);
+    float GetRawAxis(UINT32 axis);
+    bool GetRawButton(UINT32 button);
+    bool GetTrigger();
+    float GetX();
+    float GetY();
+private:
+    UINT32 m_port;
+};
+
+class DigitalInput {
+public:
+    explicit DigitalInput(UINT32 channel);
+    UINT32 Get();
+    UINT32 GetChannel();
+private:
+    UINT32 m_channel;
+};
+
+class CounterBase {
+public:
+    enum EncodingType {k1X, k2X, k4X};
+    virtual ~CounterBase() {}
+};
+
+// Quadrature encoder; the simulator counts edges on the A channel
+class Encoder : public CounterBase {
+public:
+    Encoder(UINT32 aChannel, UINT32 bChannel, bool reverseDirection = false,
+            EncodingType encodingType = k4X);
+    void Start();
+    void Stop();
+    void Reset();
+    INT32 Get();
+    INT32 GetRaw();
+    double GetDistance();
+    double GetRate();
+    void SetDistancePerPulse(double distancePerPulse);
+    void SetReverseDirection(bool reverseDirection);
+private:
+    double DecodingScale();
+
+    UINT32 m_aChannel;
+    UINT32 m_bChannel;
+    bool m_reverse;
+    EncodingType m_encodingType;
+    double m_offset;
+    double m_distancePerPulse;
+};
+
+class AnalogModule {
+public:
+    static const long kDefaultSampleRate = 50000;
+    void SetSampleRate(float samplesPerSecond);
+    float GetSampleRate();
+};
+
+// Only the accumulator is modelled, and it only has a gyro to read: the
+// channel's voltage is the gyro's zero-rate output plus its rate.
+class AnalogChannel {
+public:
+    explicit AnalogChannel(UINT32 channel);
+    AnalogModule *GetModule();
+    UINT32 GetLSBWeight();
+    INT32 GetOffset();
+    void SetAverageBits(UINT32 bits);
+    UINT32 GetAverageBits();
+    void SetOversampleBits(UINT32 bits);
+    UINT32 GetOversampleBits();
+    void InitAccumulator();
+    void ResetAccumulator();
+    void SetAccumulatorCenter(INT32 center);
+    void SetAccumulatorDeadband(INT32 deadband);
+    void GetAccumulatorOutput(INT64 *value, UINT32 *count);
+private:
+    UINT32 m_channel;
+    UINT32 m_averageBits;
+    UINT32 m_oversampleBits;
+    INT32 m_center;
+    double m_resetTime;
+    double m_resetAngle;
+};
+
+class Gyro {
+public:
+    explicit Gyro(UINT32 channel);
+    float GetAngle();
+    double GetRate();
+    void Reset();
+    void SetSensitivity(float voltsPerDegreePerSecond);
+private:
+    UINT32 m_channel;
+    double m_offset;
+};
+
+/********************************* Outputs *********************************/
+// Something that has to be fed within its expiration while the robot is
+// enabled, or sim::CheckMotorSafety() stops it
+class MotorSafety {
+public:
+    virtual ~MotorSafety() {}
+    virtual void SetExpiration(float timeout) = 0;
+    virtual float GetExpiration() = 0;
+    virtual bool IsAlive() = 0;
+    virtual void StopMotor() = 0;
+    virtual void SetSafetyEnabled(bool enabled) = 0;
+    virtual bool IsSafetyEnabled() = 0;
+};
+
+// The feeding and expiration of one MotorSafety object; every helper is
+// registered with the context for sim::CheckMotorSafety()
+class MotorSafetyHelper {
+public:
+    explicit MotorSafetyHelper(MotorSafety *safeObject);
+    ~MotorSafetyHelper();
+    void Feed();
+    void SetExpiration(float expirationTime);
+    float GetExpiration();
+    bool IsAlive();
+    void SetSafetyEnabled(bool enabled);
+    bool IsSafetyEnabled();
+    // Stops the object and returns true the first time it is found expired
+    bool Check();
+private:
+    MotorSafety *m_safeObject;
+    float m_expiration;
+    double m_lastFeed;
+    bool m_enabled;
+    bool m_expired;
+};
+
+class SpeedController {
+public:
+    virtual ~SpeedController() {}
+    virtual void Set(float value, UINT8 syncGroup = 0) = 0;
+    virtual float Get() = 0;
+    virtual void Disable() = 0;
+};
+
+// Like the cRIO's, a Talon's motor safety is off until it is turned on, and
+// every Set() feeds it
+class Talon : public SpeedController, public MotorSafety {
+public:
+    explicit Talon(UINT32 channel);
+    virtual ~Talon();
+    virtual void Set(float value, UINT8 syncGroup = 0);
+    virtual float Get();
+    virtual void Disable();
+    UINT32 GetChannel();
+
+    virtual void SetExpiration(float timeout);
+    virtual float GetExpiration();
+    virtual bool IsAlive();
+    virtual void StopMotor();
+    virtual void SetSafetyEnabled(bool enabled);
+    virtual bool IsSafetyEnabled();
+private:
+    UINT32 m_channel;
+    MotorSafetyHelper m_safetyHelper;
+};
+
+class RobotDrive : public MotorSafety {
+public:
+    enum MotorType {
+        kFrontLeftMotor = 0,
+        kFrontRightMotor = 1,
+        kRearLeftMotor = 2,
+        kRearRightMotor = 3
+    };
+    static const int kMaxNumberOfMotors = 4;
+
+    RobotDrive(SpeedController *frontLeftMotor, SpeedController *rearLeftMotor,
+               SpeedController *frontRightMotor, SpeedController *rearRightMotor);
+    virtual ~RobotDrive();
+
+    void TankDrive(float leftValue, float rightValue, bool squaredInputs = true);
+    void MecanumDrive_Cartesian(float x, float y, float rotation, float gyroAngle = 0.0);
+    void SetLeftRightMotorOutputs(float leftOutput, float rightOutput);
+    void SetInvertedMotor(MotorType motor, bool isInverted);
+    void SetMaxOutput(double maxOutput);
+
+    virtual void SetExpiration(float timeout);
+    virtual float GetExpiration();
+    virtual bool IsAlive();
+    virtual void StopMotor();
+    virtual void SetSafetyEnabled(bool enabled);
+    virtual bool IsSafetyEnabled();
+private:
+    SpeedController *m_frontLeftMotor;
+    SpeedController *m_frontRightMotor;
+    SpeedController *m_rearLeftMotor;
+    SpeedController *m_rearRightMotor;
+    int m_invertedMotors[kMaxNumberOfMotors];
+    double m_maxOutput;
+    MotorSafetyHelper m_safetyHelper;
+};
+
+class DoubleSolenoid {
+public:
+    enum Value {kOff, kForward, kReverse};
+    DoubleSolenoid(UINT32 forwardChannel, UINT32 reverseChannel);
+    void Set(Value value);
+    Value Get();
+private:
+    UINT32 m_forwardChannel;
+    UINT32 m_reverseChannel;
+};
+
+class Relay {
+public:
+    enum Value {kOff, kOn, kForward, kReverse};
+    enum Direction {kBothDirections, kForwardOnly, kReverseOnly};
+    explicit Relay(UINT32 channel, Direction direction = kBothDirections);
+    void Set(Value value);
+    Value Get();
+private:
+    UINT32 m_channel;
+};
+
+class Compressor {
+public:
+    Compressor(UINT32 pressureSwitchChannel, UINT32 compressorRelayChannel);
+    void Start();
+    void Stop();
+    bool Enabled();
+    UINT32 GetPressureSwitchValue();
+private:
+    UINT32 m_pressureSwitchChannel;
+    UINT32 m_relayChannel;
+};
+
+/* Calls a handler on the virtual clock. Handlers run whenever the clock
+ * moves past their time, inside Wait() or between driver station packets,
+ * which stands in for the notifier task preempting the robot task.
+ */
+typedef void (*TimerEventHandler)(void *param);
+
+class Notifier {
+public:
+    Notifier(TimerEventHandler handler, void *param = 0);
+    virtual ~Notifier();
+    void StartSingle(double delay);
+    void StartPeriodic(double period);
+    void Stop();
+private:
+    friend struct NotifierQueue;
+    TimerEventHandler m_handler;
+    void *m_param;
+    double m_expirationTime;
+    double m_period;
+    bool m_periodic;
+    bool m_queued;
+};
+
+/* A background task. Unlike everything else in the simulator it runs on a
+ * real thread, using the creating thread's context. A task never moves the
+ * robot's clock: Wait() there sleeps until the robot thread has advanced
+ * the virtual clock far enough (or that long in real time, whichever comes
+ * first) and clock reads cost nothing. The robot thread in turn stops the
+ * clock at each time a task wakes up until the task is waiting again, so a
+ * task runs when it would on the cRIO however fast the host is. Arguments
+ * are passed as size_t so a pointer fits on a 64-bit host.
+ */
+typedef int (*FUNCPTR)(...);
+
+class Task {
+public:
+    static const INT32 kDefaultPriority = 101;
+
+    Task(const char *name, FUNCPTR function, INT32 priority = kDefaultPriority,
+         UINT32 stackSize = 20000);
+    virtual ~Task();
+    bool Start(size_t arg0 = 0, size_t arg1 = 0, size_t arg2 = 0, size_t arg3 = 0);
+    // Can't kill a thread on the host; forgets it and lets it run out
+    bool Stop();
+    const char *GetName();
+    INT32 GetPriority();
+private:
+    std::string m_name;
+    FUNCPTR m_function;
+    INT32 m_priority;
+    void *m_thread;
+};
+
+/****************************** Synchronization ****************************/
+class ReentrantSemaphore {
+public:
+    ReentrantSemaphore();
+    ~ReentrantSemaphore();
+    int take();
+    int give();
+private:
+    void *m_mutex;
+};
+
+// Holds a semaphore for the rest of the enclosing scope
+class Synchronized {
+public:
+    explicit Synchronized(ReentrantSemaphore &semaphore) : m_semaphore(semaphore) {
+        m_semaphore.take();
+    }
+    ~Synchronized() {
+        m_semaphore.give();
+    }
+private:
+    ReentrantSemaphore &m_semaphore;
+};
+
+/****************************** Driver Station *****************************/
+class DriverStation {
+public:
+    static const UINT32 kJoystickPorts = 4;
+    static DriverStation *GetInstance();
+    float GetStickAxis(UINT32 stick, UINT32 axis);
+    short GetStickButtons(UINT32 stick);
+    float GetBatteryVoltage();
+    bool IsEnabled();
+    bool IsDisabled();
+    bool IsAutonomous();
+    bool IsOperatorControl();
+};
+
+class DriverStationLCD {
+public:
+    static const UINT32 kLineLength = 21;
+    static const UINT32 kNumLines = 6;
+    enum Line {
+        kMain_Line6 = 0,
+        kUser_Line1 = 0,
+        kUser_Line2 = 1,
+        kUser_Line3 = 2,
+        kUser_Line4 = 3,
+        kUser_Line5 = 4,
+        kUser_Line6 = 5
+    };
+
+    static DriverStationLCD *GetInstance();
+    void UpdateLCD();
+    void Printf(Line line, INT32 startingColumn, const char *writeFmt, ...);
+    void PrintfLine(Line line, const char *writeFmt, ...);
+    void Clear();
+};
+
+/******************************** Preferences ******************************/
+// The robot's settings file. Here the settings live in the context and
+// start out empty, so every Get returns its default unless the driver put
+// something there first; Save() writes nothing.
+class Preferences {
+public:
+    static Preferences *GetInstance();
+    std::string GetString(const char *key, const char *defaultValue = "");
+    int GetInt(const char *key, int defaultValue = 0);
+    double GetDouble(const char *key, double defaultValue = 0.0);
+    float GetFloat(const char *key, float defaultValue = 0.0);
+    bool GetBoolean(const char *key, bool defaultValue = false);
+    void PutString(const char *key, const char *value);
+    void PutDouble(const char *key, double value);
+    bool ContainsKey(const char *key);
+    void Remove(const char *key);
+    void Save();
+};
+
+/***************************** Robot framework *****************************/
+class RobotBase {
+public:
+    virtual ~RobotBase() {}
+    bool IsEnabled();
+    bool IsDisabled();
+    bool IsAutonomous();
+    bool IsOperatorControl();
+    bool IsTest();
+};
+
+class IterativeRobot : public RobotBase {
+public:
+    IterativeRobot() : period(0.0) {}
+    // 0 (the default) runs the periodic routines once per driver station
+    // packet; anything else at that period
+    void SetPeriod(double seconds) {
+        period = seconds;
+    }
+    double GetPeriod() {
+        return period;
+    }
+    virtual void RobotInit() {}
+    virtual void DisabledInit() {}
+    virtual void AutonomousInit() {}
+    virtual void TeleopInit() {}
+    virtual void TestInit() {}
+
+    virtual void DisabledPeriodic() {}
+    virtual void AutonomousPeriodic() {}
+    virtual void TeleopPeriodic() {}
+    virtual void TestPeriodic() {}
+private:
+    double period;
+};
+
+// The simulator driver creates the robot through this factory, the same way
+// the cRIO runtime does.
+#define START_ROBOT_CLASS(_ClassName_) \
+    RobotBase *FRC_userClassFactory() { return new _ClassName_(); }
+
+#endif
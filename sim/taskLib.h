@@ -0,0 +1,10 @@
+/* Stand-in for the part of vxWorks' taskLib the robot code uses.
+ *
+ * Each host thread gets its own id the first time it asks.
+ */
+#ifndef SIM_TASKLIB_H
+#define SIM_TASKLIB_H
+
+int taskIdSelf();
+
+#endif